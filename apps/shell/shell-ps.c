@@ -56,10 +56,26 @@ PROCESS_THREAD(shell_ps_process, ev, data)
   PROCESS_BEGIN();
 
   shell_output_str(&ps_command, "Processes:", "");
+#if PROCESS_TIMING
+  shell_output_str(&ps_command,
+		   "name: calls time max events latency max (rtimer ticks)", "");
+#endif /* PROCESS_TIMING */
   for(p = PROCESS_LIST(); p != NULL; p = p->next) {
     char namebuf[30];
+#if PROCESS_TIMING
+    char timebuf[80];
+    const struct process_timing *t = process_get_timing(p);
+    snprintf(timebuf, sizeof(timebuf), ": %lu %lu %lu %lu %lu %lu",
+	     t->calls, t->time, t->max_time,
+	     t->events, t->latency, t->max_latency);
+#endif /* PROCESS_TIMING */
     strncpy(namebuf, PROCESS_NAME_STRING(p), sizeof(namebuf));
+    namebuf[sizeof(namebuf) - 1] = 0;
+#if PROCESS_TIMING
+    shell_output_str(&ps_command, namebuf, timebuf);
+#else /* PROCESS_TIMING */
     shell_output_str(&ps_command, namebuf, "");
+#endif /* PROCESS_TIMING */
   }
 
   PROCESS_END();
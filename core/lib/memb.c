@@ -53,6 +53,13 @@ memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST
+  m->free = 0;
+  m->top = 0;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+  m->used = m->max_used = m->failed = m->bad_free = 0;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,44 +67,81 @@ memb_alloc(struct memb *m)
 {
   int i;
 
+#if MEMB_FREELIST
+  if(m->free != 0) {
+    i = m->free - 1;
+    m->free = m->next[i];
+  } else if(m->top < m->num) {
+    i = m->top++;
+  } else {
+    i = m->num;
+  }
+#else /* MEMB_FREELIST */
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
+      break;
     }
   }
+#endif /* MEMB_FREELIST */
+
+  if(i < m->num) {
+    /* If this block was unused, we increase the reference count to
+       indicate that it now is used and return a pointer to the
+       memory block. */
+    ++(m->count[i]);
+#if MEMB_STATS
+    if(++m->used > m->max_used) {
+      m->max_used = m->used;
+    }
+#endif /* MEMB_STATS */
+    return (void *)((char *)m->mem + (i * m->size));
+  }
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+#if MEMB_STATS
+  m->failed++;
+#endif /* MEMB_STATS */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
 char
 memb_free(struct memb *m, void *ptr)
 {
+  unsigned int offset;
   int i;
-  char *ptr2;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    
-    if(ptr2 == (char *)ptr) {
-      /* We've found to block to which "ptr" points so we decrease the
-	 reference count and return the new value of it. */
-      if(m->count[i] > 0) {
-	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
-      }
-      return m->count[i];
+  /* Find the block to which "ptr" points from its offset in the
+     pool. */
+  offset = (char *)ptr - (char *)m->mem;
+  if(!memb_inmemb(m, ptr) || offset % m->size != 0) {
+#if MEMB_STATS
+    m->bad_free++;
+#endif /* MEMB_STATS */
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* We've found to block to which "ptr" points so we decrease the
+     reference count and return the new value of it. */
+  if(m->count[i] > 0) {
+    /* Make sure that we don't deallocate free memory. */
+    --(m->count[i]);
+    if(m->count[i] == 0) {
+#if MEMB_FREELIST
+      m->next[i] = m->free;
+      m->free = i + 1;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+      m->used--;
+#endif /* MEMB_STATS */
     }
-    ptr2 += m->size;
+#if MEMB_STATS
+  } else {
+    m->bad_free++;
+#endif /* MEMB_STATS */
   }
-  return -1;
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -107,5 +151,18 @@ memb_inmemb(struct memb *m, void *ptr)
     (char *)ptr < (char *)m->mem + (m->num * m->size);
 }
 /*---------------------------------------------------------------------------*/
+int
+memb_numfree(struct memb *m)
+{
+  int i, num_free = 0;
+
+  for(i = 0; i < m->num; ++i) {
+    if(m->count[i] == 0) {
+      ++num_free;
+    }
+  }
+  return num_free;
+}
+/*---------------------------------------------------------------------------*/
 
 /** @} */
@@ -65,6 +65,27 @@
 
 #include "sys/cc.h"
 
+/*
+ * With MEMB_CONF_FREELIST, the free blocks of each pool are kept on a
+ * list so that memb_alloc() does not have to search for a free
+ * block. The list costs two bytes of RAM per block.
+ */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
+/*
+ * With MEMB_CONF_STATS, each pool counts allocated blocks, failed
+ * allocations and bad frees.
+ */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else /* MEMB_CONF_STATS */
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
 /**
  * Declare a memory block.
  *
@@ -86,18 +107,49 @@ MEMB(connections, struct connection, 16);
  * \param num The total number of memory chunks in the block.
  *
  */
+#if MEMB_FREELIST
+#define MEMB(name, structure, num) \
+        static char CC_CONCAT(name,_memb_count)[num]; \
+        static structure CC_CONCAT(name,_memb_mem)[num]; \
+        static unsigned short CC_CONCAT(name,_memb_next)[num]; \
+        static struct memb name = {sizeof(structure), num, \
+                                          CC_CONCAT(name,_memb_count), \
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          CC_CONCAT(name,_memb_next)}
+#else /* MEMB_FREELIST */
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
                                           (void *)CC_CONCAT(name,_memb_mem)}
+#endif /* MEMB_FREELIST */
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREELIST
+  /* The free blocks are linked through next[], which holds the index
+     of the next free block plus one. Blocks from top and upwards have
+     never been allocated and are not on the list. A zeroed structure
+     is an empty pool, so memb_init() is not strictly needed. */
+  unsigned short *next;
+  unsigned short free;
+  unsigned short top;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+  /** The number of blocks currently allocated. */
+  unsigned short used;
+  /** The largest number of blocks that have been allocated at once. */
+  unsigned short max_used;
+  /** The number of allocations that failed because the pool was full. */
+  unsigned short failed;
+  /** The number of calls to memb_free() with a block that was already
+      free or a pointer that was not a block of the pool. */
+  unsigned short bad_free;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -130,6 +182,14 @@ char  memb_free(struct memb *m, void *ptr);
 
 int memb_inmemb(struct memb *m, void *ptr);
 
+/**
+ * Get the number of free blocks in a memory block declared with
+ * MEMB().
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+int memb_numfree(struct memb *m);
+
 
 /** @} */
 /** @} */
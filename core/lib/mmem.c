@@ -55,10 +55,111 @@
 #define MMEM_SIZE 4096
 #endif
 
-LIST(mmemlist);
+/*
+ * With MMEM_CONF_SIZE_CLASSES, the memory is managed as a binary
+ * buddy system instead of being compacted. Each allocation is rounded
+ * up to a power of two, at least MMEM_MIN_BLOCK bytes, and freed
+ * blocks are merged with their free buddies. Allocation and
+ * deallocation take time proportional to the number of size classes,
+ * and allocated memory never moves.
+ */
+#ifdef MMEM_CONF_SIZE_CLASSES
+#define MMEM_SIZE_CLASSES MMEM_CONF_SIZE_CLASSES
+#else
+#define MMEM_SIZE_CLASSES 0
+#endif
+
 unsigned int avail_memory;
+
+#if MMEM_SIZE_CLASSES
+
+#ifdef MMEM_CONF_MIN_BLOCK
+#define MMEM_MIN_BLOCK MMEM_CONF_MIN_BLOCK
+#else
+#define MMEM_MIN_BLOCK 16
+#endif
+
+/* Size classes for blocks from MMEM_MIN_BLOCK bytes up to 2048 times
+   that. Larger memories are cut into several blocks of the largest
+   class. */
+#define NUM_CLASSES 12
+#define NUM_UNITS (MMEM_SIZE / MMEM_MIN_BLOCK)
+
+/* Free blocks are kept on one doubly linked list per size class. */
+struct free_block {
+  struct free_block *next, *prev;
+};
+
+static union {
+  char bytes[NUM_UNITS * MMEM_MIN_BLOCK];
+  struct free_block align;
+} heap;
+#define memory heap.bytes
+
+static struct free_block *free_lists[NUM_CLASSES];
+
+/* For the first unit of each block: the size class of the block, and
+   whether it is free. */
+static unsigned char unit_tag[NUM_UNITS];
+#define TAG_FREE 0x80
+
+/* Bytes requested by the allocated blocks, for the statistics. */
+static unsigned int requested_memory;
+
+#else /* MMEM_SIZE_CLASSES */
+
+LIST(mmemlist);
 static char memory[MMEM_SIZE];
 
+#endif /* MMEM_SIZE_CLASSES */
+
+#if MMEM_SIZE_CLASSES
+/*---------------------------------------------------------------------------*/
+static void
+push_free(char *b, int class)
+{
+  struct free_block *f = (struct free_block *)b;
+
+  f->prev = NULL;
+  f->next = free_lists[class];
+  if(f->next != NULL) {
+    f->next->prev = f;
+  }
+  free_lists[class] = f;
+  unit_tag[(b - memory) / MMEM_MIN_BLOCK] = class | TAG_FREE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_free(char *b, int class)
+{
+  struct free_block *f = (struct free_block *)b;
+
+  if(f->prev != NULL) {
+    f->prev->next = f->next;
+  } else {
+    free_lists[class] = f->next;
+  }
+  if(f->next != NULL) {
+    f->next->prev = f->prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned int
+class_size(int class)
+{
+  return (unsigned int)MMEM_MIN_BLOCK << class;
+}
+/*---------------------------------------------------------------------------*/
+static int
+size_to_class(unsigned int size)
+{
+  int class;
+
+  for(class = 0; class < NUM_CLASSES && class_size(class) < size; class++);
+  return class;
+}
+#endif /* MMEM_SIZE_CLASSES */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Allocate a managed memory block
@@ -82,6 +183,34 @@ static char memory[MMEM_SIZE];
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
+#if MMEM_SIZE_CLASSES
+  int class, c;
+  char *b;
+
+  class = size_to_class(size);
+  for(c = class; c < NUM_CLASSES && free_lists[c] == NULL; c++);
+  if(c >= NUM_CLASSES) {
+    return 0;
+  }
+
+  /* Take the smallest free block that is large enough, and split it
+     until it has the right size. The upper halves go back to the free
+     lists. */
+  b = (char *)free_lists[c];
+  unlink_free(b, c);
+  while(c > class) {
+    c--;
+    push_free(b + class_size(c), c);
+  }
+  unit_tag[(b - memory) / MMEM_MIN_BLOCK] = class;
+
+  m->next = NULL;
+  m->ptr = b;
+  m->size = size;
+  avail_memory -= class_size(class);
+  requested_memory += size;
+  return 1;
+#else /* MMEM_SIZE_CLASSES */
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
     return 0;
@@ -104,6 +233,7 @@ mmem_alloc(struct mmem *m, unsigned int size)
   /* Return non-zero to indicate that we were able to allocate
      memory. */
   return 1;
+#endif /* MMEM_SIZE_CLASSES */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -118,6 +248,34 @@ mmem_alloc(struct mmem *m, unsigned int size)
 void
 mmem_free(struct mmem *m)
 {
+#if MMEM_SIZE_CLASSES
+  unsigned int offset, buddy;
+  int class;
+
+  offset = (char *)m->ptr - memory;
+  class = unit_tag[offset / MMEM_MIN_BLOCK];
+  avail_memory += class_size(class);
+  requested_memory -= m->size;
+
+  /* Merge the block with its buddy for as long as the buddy is free
+     and of the same size. */
+  while(class < NUM_CLASSES - 1) {
+    buddy = offset ^ class_size(class);
+    if(buddy + class_size(class) > sizeof(memory) ||
+       unit_tag[buddy / MMEM_MIN_BLOCK] != (class | TAG_FREE)) {
+      break;
+    }
+    unlink_free(&memory[buddy], class);
+    if(buddy < offset) {
+      unit_tag[offset / MMEM_MIN_BLOCK] = 0;
+      offset = buddy;
+    } else {
+      unit_tag[buddy / MMEM_MIN_BLOCK] = 0;
+    }
+    class++;
+  }
+  push_free(&memory[offset], class);
+#else /* MMEM_SIZE_CLASSES */
   struct mmem *n;
 
   if(m->next != NULL) {
@@ -137,6 +295,7 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_SIZE_CLASSES */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -151,8 +310,66 @@ mmem_free(struct mmem *m)
 void
 mmem_init(void)
 {
+#if MMEM_SIZE_CLASSES
+  unsigned int offset;
+  int class;
+
+  memset(free_lists, 0, sizeof(free_lists));
+  memset(unit_tag, 0, sizeof(unit_tag));
+  requested_memory = 0;
+  avail_memory = sizeof(memory);
+
+  /* Cut the memory into the largest blocks that are aligned to their
+     own size. */
+  offset = 0;
+  while(offset < sizeof(memory)) {
+    for(class = NUM_CLASSES - 1;
+	offset % class_size(class) != 0 ||
+	  offset + class_size(class) > sizeof(memory);
+	class--);
+    push_free(&memory[offset], class);
+    offset += class_size(class);
+  }
+#else /* MMEM_SIZE_CLASSES */
   list_init(mmemlist);
   avail_memory = MMEM_SIZE;
+#endif /* MMEM_SIZE_CLASSES */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get statistics for the managed memory
+ * \param stats A pointer to a structure that is filled in
+ *
+ *             With the compacting allocator, all free memory is
+ *             always in one block, so the largest free block equals
+ *             the free memory and there is no rounding loss.
+ *
+ */
+void
+mmem_get_stats(struct mmem_stats *stats)
+{
+#if MMEM_SIZE_CLASSES
+  struct free_block *f;
+  int class;
+
+  stats->size = sizeof(memory);
+  stats->free = avail_memory;
+  stats->largest_free = 0;
+  stats->free_blocks = 0;
+  for(class = 0; class < NUM_CLASSES; class++) {
+    for(f = free_lists[class]; f != NULL; f = f->next) {
+      stats->largest_free = class_size(class);
+      stats->free_blocks++;
+    }
+  }
+  stats->rounding = sizeof(memory) - avail_memory - requested_memory;
+#else /* MMEM_SIZE_CLASSES */
+  stats->size = MMEM_SIZE;
+  stats->free = avail_memory;
+  stats->largest_free = avail_memory;
+  stats->free_blocks = avail_memory > 0;
+  stats->rounding = 0;
+#endif /* MMEM_SIZE_CLASSES */
 }
 /*---------------------------------------------------------------------------*/
 
@@ -44,6 +44,12 @@
  * stays in place. Therefore, a level of indirection is used: access
  * to allocated memory must always be done using a special macro.
  *
+ * With MMEM_CONF_SIZE_CLASSES, the memory is instead managed as a
+ * buddy system with power-of-two size classes. Memory is not
+ * compacted, so allocated blocks stay in place, at the cost of
+ * rounding each allocation up to the next size class. The
+ * MMEM_PTR() macro works in both modes.
+ *
  * \note This module has not been heavily tested.
  * @{
  */
@@ -83,9 +89,28 @@ struct mmem {
 /* XXX: tagga minne med "interrupt usage", vilke gr att man r
    speciellt varsam under free(). */
 
+/**
+ * Statistics for the managed memory, as returned by mmem_get_stats().
+ */
+struct mmem_stats {
+  /** The size of the managed memory. */
+  unsigned int size;
+  /** The number of free bytes. */
+  unsigned int free;
+  /** The size of the largest free block, which is the largest
+      allocation that can succeed. */
+  unsigned int largest_free;
+  /** The number of free blocks the free memory is split into. */
+  unsigned int free_blocks;
+  /** The number of allocated bytes that are lost to rounding
+      allocations up to their size class. */
+  unsigned int rounding;
+};
+
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
+void mmem_get_stats(struct mmem_stats *stats);
 
 #endif /* __MMEM_H__ */
 
@@ -38,6 +38,8 @@
  */
 
 #include "lib/ringbuf.h"
+
+#include <string.h>
 /*---------------------------------------------------------------------------*/
 void
 ringbuf_init(struct ringbuf *r, uint8_t *dataptr, uint8_t size)
@@ -93,6 +95,53 @@ ringbuf_get(struct ringbuf *r)
 }
 /*---------------------------------------------------------------------------*/
 int
+ringbuf_put_n(struct ringbuf *r, const uint8_t *data, int len)
+{
+  uint8_t put_ptr;
+  int room, n;
+
+  put_ptr = r->put_ptr;
+  room = r->mask - ((put_ptr - r->get_ptr) & r->mask);
+  if(len > room) {
+    len = room;
+  }
+
+  /* Copy up to the end of the buffer, then the rest from the
+     beginning. The put pointer is updated last, so that the reader
+     sees either none or all of the bytes. */
+  n = r->mask + 1 - put_ptr;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(&r->data[put_ptr], data, n);
+  memcpy(&r->data[0], data + n, len - n);
+  r->put_ptr = (put_ptr + len) & r->mask;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbuf_get_n(struct ringbuf *r, uint8_t *buf, int len)
+{
+  uint8_t get_ptr;
+  int avail, n;
+
+  get_ptr = r->get_ptr;
+  avail = (r->put_ptr - get_ptr) & r->mask;
+  if(len > avail) {
+    len = avail;
+  }
+
+  n = r->mask + 1 - get_ptr;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(buf, &r->data[get_ptr], n);
+  memcpy(buf + n, &r->data[0], len - n);
+  r->get_ptr = (get_ptr + len) & r->mask;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
 ringbuf_size(struct ringbuf *r)
 {
   return r->mask + 1;
@@ -114,6 +114,37 @@ int     ringbuf_put(struct ringbuf *r, uint8_t c);
  */
 int     ringbuf_get(struct ringbuf *r);
 
+/**
+ * \brief      Insert a number of bytes into the ring buffer
+ * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
+ * \param data A pointer to the bytes to be written to the buffer
+ * \param len  The number of bytes to write
+ * \return     The number of bytes that were written, which is less than len if the buffer became full.
+ *
+ *             This function copies as many bytes as there is room for
+ *             into the ring buffer, and makes them visible to
+ *             ringbuf_get() all at once. It is safe to call this
+ *             function from an interrupt handler, but not concurrently
+ *             with ringbuf_put().
+ *
+ */
+int     ringbuf_put_n(struct ringbuf *r, const uint8_t *data, int len);
+
+/**
+ * \brief      Get a number of bytes from the ring buffer
+ * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
+ * \param buf  A pointer to where the bytes should be copied
+ * \param len  The maximum number of bytes to get
+ * \return     The number of bytes that were copied to buf
+ *
+ *             This function removes up to len bytes from the ring
+ *             buffer. It is safe to call this function from an
+ *             interrupt handler, but not concurrently with
+ *             ringbuf_get().
+ *
+ */
+int     ringbuf_get_n(struct ringbuf *r, uint8_t *buf, int len);
+
 /**
  * \brief      Get the size of a ring buffer
  * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Ring buffer index library implementation
+ */
+
+#include "lib/ringbufindex.h"
+
+#if RINGBUFINDEX_MPSC && defined(__unix__)
+/* The native platform waits for other producers with sched_yield(). */
+#include <sched.h>
+#endif /* RINGBUFINDEX_MPSC && __unix__ */
+/*---------------------------------------------------------------------------*/
+void
+ringbufindex_init(struct ringbufindex *r, unsigned int size)
+{
+  r->mask = size - 1;
+  r->put_ptr = 0;
+  r->get_ptr = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_peek_put(struct ringbufindex *r)
+{
+  /* As in the ringbuf library, the positions are assumed to be read
+     and written atomically. Only the producer writes ->put_ptr and
+     only the consumer writes ->get_ptr. */
+  if(r->put_ptr - r->get_ptr > r->mask) {
+    return -1;
+  }
+  return r->put_ptr & r->mask;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_put(struct ringbufindex *r)
+{
+  if(r->put_ptr - r->get_ptr > r->mask) {
+    return 0;
+  }
+  r->put_ptr++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_peek_get(struct ringbufindex *r)
+{
+  if(r->put_ptr == r->get_ptr) {
+    return -1;
+  }
+  return r->get_ptr & r->mask;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_get(struct ringbufindex *r)
+{
+  unsigned int get_ptr;
+
+  get_ptr = r->get_ptr;
+  if(r->put_ptr == get_ptr) {
+    return -1;
+  }
+  r->get_ptr = get_ptr + 1;
+  return get_ptr & r->mask;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_put_span(struct ringbufindex *r, int *index)
+{
+  unsigned int put_ptr, room, n;
+
+  put_ptr = r->put_ptr;
+  room = r->mask + 1 - (put_ptr - r->get_ptr);
+  n = r->mask + 1 - (put_ptr & r->mask);
+  *index = put_ptr & r->mask;
+  return n < room ? n : room;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufindex_put_n(struct ringbufindex *r, int n)
+{
+  r->put_ptr += n;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_get_span(struct ringbufindex *r, int *index)
+{
+  unsigned int get_ptr, avail, n;
+
+  get_ptr = r->get_ptr;
+  avail = r->put_ptr - get_ptr;
+  n = r->mask + 1 - (get_ptr & r->mask);
+  *index = get_ptr & r->mask;
+  return n < avail ? n : avail;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufindex_get_n(struct ringbufindex *r, int n)
+{
+  r->get_ptr += n;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_elements(struct ringbufindex *r)
+{
+  return r->put_ptr - r->get_ptr;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_size(struct ringbufindex *r)
+{
+  return r->mask + 1;
+}
+/*---------------------------------------------------------------------------*/
+#if RINGBUFINDEX_MPSC
+/* The GCC atomic builtins implement the C11 memory model and work
+   also when compiling as C99. */
+#define LOAD(p, order)     __atomic_load_n(p, order)
+#define STORE(p, v, order) __atomic_store_n(p, v, order)
+
+void
+ringbufindex_mpsc_init(struct ringbufindex_mpsc *r, unsigned int size)
+{
+  r->mask = size - 1;
+  STORE(&r->reserve_ptr, 0, __ATOMIC_RELAXED);
+  STORE(&r->put_ptr, 0, __ATOMIC_RELAXED);
+  STORE(&r->get_ptr, 0, __ATOMIC_RELEASE);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_mpsc_reserve(struct ringbufindex_mpsc *r, int n, unsigned int *pos)
+{
+  unsigned int reserve_ptr;
+
+  reserve_ptr = LOAD(&r->reserve_ptr, __ATOMIC_RELAXED);
+  do {
+    /* The get position is read with acquire semantics, so that the
+       consumer is done with the elements before they are reused. */
+    if(reserve_ptr + n - LOAD(&r->get_ptr, __ATOMIC_ACQUIRE) > r->mask + 1) {
+      return 0;
+    }
+  } while(!__atomic_compare_exchange_n(&r->reserve_ptr, &reserve_ptr,
+                                       reserve_ptr + n, 1,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  *pos = reserve_ptr;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufindex_mpsc_commit(struct ringbufindex_mpsc *r, unsigned int pos, int n)
+{
+  /* Wait for the producers that reserved elements before us. They
+     only have to copy their elements, so the wait is short. The
+     position is read with acquire semantics, so that our release
+     below also publishes the elements of the earlier producers. */
+  while(LOAD(&r->put_ptr, __ATOMIC_ACQUIRE) != pos) {
+    RINGBUFINDEX_MPSC_WAIT();
+  }
+  STORE(&r->put_ptr, pos + n, __ATOMIC_RELEASE);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufindex_mpsc_get_span(struct ringbufindex_mpsc *r, int *index)
+{
+  unsigned int get_ptr, avail, n;
+
+  get_ptr = LOAD(&r->get_ptr, __ATOMIC_RELAXED);
+  avail = LOAD(&r->put_ptr, __ATOMIC_ACQUIRE) - get_ptr;
+  n = r->mask + 1 - (get_ptr & r->mask);
+  *index = get_ptr & r->mask;
+  return n < avail ? n : avail;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufindex_mpsc_get_n(struct ringbufindex_mpsc *r, int n)
+{
+  STORE(&r->get_ptr, LOAD(&r->get_ptr, __ATOMIC_RELAXED) + n, __ATOMIC_RELEASE);
+}
+#endif /* RINGBUFINDEX_MPSC */
+/*---------------------------------------------------------------------------*/
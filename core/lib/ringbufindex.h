@@ -0,0 +1,256 @@
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup ringbufindex Ring buffer index library
+ * @{
+ *
+ * The ring buffer index library keeps track of the read and write
+ * positions of a ring buffer, but not of the data itself. The data
+ * is kept in an array of any element type, which is indexed with the
+ * positions returned by the library. This makes it possible to
+ * queue structures, such as received frames, and not just bytes.
+ *
+ * Elements can be put and taken one at a time, or as contiguous
+ * spans of the array so that several elements can be copied with
+ * one memcpy(). A ring buffer may be used by one producer and one
+ * consumer, one of which may run in an interrupt handler.
+ *
+ * With RINGBUFINDEX_CONF_MPSC, a multi-producer variant is also
+ * available, in which several threads may put elements concurrently.
+ *
+ */
+
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the ring buffer index library
+ */
+
+#ifndef __RINGBUFINDEX_H__
+#define __RINGBUFINDEX_H__
+
+#include "contiki-conf.h"
+
+#ifdef RINGBUFINDEX_CONF_MPSC
+#define RINGBUFINDEX_MPSC RINGBUFINDEX_CONF_MPSC
+#else /* RINGBUFINDEX_CONF_MPSC */
+#define RINGBUFINDEX_MPSC 0
+#endif /* RINGBUFINDEX_CONF_MPSC */
+
+/* RINGBUFINDEX_CONF_MPSC_WAIT() is called while a producer waits for
+   earlier producers to commit. On hosts, it should yield the CPU. */
+#ifdef RINGBUFINDEX_CONF_MPSC_WAIT
+#define RINGBUFINDEX_MPSC_WAIT() RINGBUFINDEX_CONF_MPSC_WAIT()
+#else /* RINGBUFINDEX_CONF_MPSC_WAIT */
+#define RINGBUFINDEX_MPSC_WAIT()
+#endif /* RINGBUFINDEX_CONF_MPSC_WAIT */
+
+/**
+ * \brief      Structure that holds the state of a ring buffer index.
+ *
+ *             The put and get positions run freely and are masked
+ *             only when used as array indices. They are of the
+ *             native int size, so that they can be read and written
+ *             atomically on most platforms.
+ */
+struct ringbufindex {
+  unsigned int mask;
+  volatile unsigned int put_ptr, get_ptr;
+};
+
+/**
+ * \brief      Initialize a ring buffer index
+ * \param r    A pointer to the ring buffer index
+ * \param size The number of elements in the array, which must be a power of two
+ *
+ *             All elements of the array can be used. The size can be
+ *             up to half the range of an unsigned int, that is 32768
+ *             elements on 16-bit platforms.
+ */
+void ringbufindex_init(struct ringbufindex *r, unsigned int size);
+
+/**
+ * \brief      Get the index of the next element to write
+ * \param r    A pointer to the ring buffer index
+ * \return     The array index where the element should be written, or -1 if the buffer is full
+ *
+ *             The element is not visible to the consumer until
+ *             ringbufindex_put() has been called.
+ */
+int ringbufindex_peek_put(struct ringbufindex *r);
+
+/**
+ * \brief      Make the next element visible to the consumer
+ * \param r    A pointer to the ring buffer index
+ * \return     Non-zero if the element was put, zero if the buffer is full
+ */
+int ringbufindex_put(struct ringbufindex *r);
+
+/**
+ * \brief      Get the index of the next element to read
+ * \param r    A pointer to the ring buffer index
+ * \return     The array index of the oldest element, or -1 if the buffer is empty
+ *
+ *             The element stays in the buffer until ringbufindex_get()
+ *             is called.
+ */
+int ringbufindex_peek_get(struct ringbufindex *r);
+
+/**
+ * \brief      Remove the oldest element
+ * \param r    A pointer to the ring buffer index
+ * \return     The array index of the removed element, or -1 if the buffer is empty
+ */
+int ringbufindex_get(struct ringbufindex *r);
+
+/**
+ * \brief      Get a contiguous span of free elements
+ * \param r    A pointer to the ring buffer index
+ * \param index A pointer to where the array index of the first free element is stored
+ * \return     The number of free elements that follow, without wrapping, from *index
+ *
+ *             The elements are written by the caller, and then made
+ *             visible with ringbufindex_put_n(). If the free space
+ *             wraps around the end of the array, a second call after
+ *             ringbufindex_put_n() returns the rest.
+ */
+int ringbufindex_put_span(struct ringbufindex *r, int *index);
+
+/**
+ * \brief      Make a number of written elements visible to the consumer
+ * \param r    A pointer to the ring buffer index
+ * \param n    The number of elements, which must not be more than there is room for
+ */
+void ringbufindex_put_n(struct ringbufindex *r, int n);
+
+/**
+ * \brief      Get a contiguous span of elements to read
+ * \param r    A pointer to the ring buffer index
+ * \param index A pointer to where the array index of the oldest element is stored
+ * \return     The number of elements that follow, without wrapping, from *index
+ */
+int ringbufindex_get_span(struct ringbufindex *r, int *index);
+
+/**
+ * \brief      Remove a number of elements
+ * \param r    A pointer to the ring buffer index
+ * \param n    The number of elements, which must not be more than there are in the buffer
+ */
+void ringbufindex_get_n(struct ringbufindex *r, int n);
+
+/**
+ * \brief      Get the number of elements in the ring buffer
+ * \param r    A pointer to the ring buffer index
+ * \return     The number of elements in the buffer
+ */
+int ringbufindex_elements(struct ringbufindex *r);
+
+/**
+ * \brief      Get the size of the ring buffer
+ * \param r    A pointer to the ring buffer index
+ * \return     The number of elements that fit in the buffer
+ */
+int ringbufindex_size(struct ringbufindex *r);
+
+#if RINGBUFINDEX_MPSC
+/**
+ * \brief      Structure that holds the state of a multi-producer ring buffer index.
+ *
+ *             Producers first reserve elements by moving the reserve
+ *             position, then write them, and finally commit them by
+ *             moving the put position. Commits are made in the order
+ *             that the elements were reserved. The positions are
+ *             updated with the atomic operations of the compiler,
+ *             using the C11 memory model.
+ */
+struct ringbufindex_mpsc {
+  unsigned int mask;
+  unsigned int reserve_ptr, put_ptr, get_ptr;
+};
+
+/**
+ * \brief      Initialize a multi-producer ring buffer index
+ * \param r    A pointer to the ring buffer index
+ * \param size The number of elements in the array, which must be a power of two
+ */
+void ringbufindex_mpsc_init(struct ringbufindex_mpsc *r, unsigned int size);
+
+/**
+ * \brief      Reserve elements for writing
+ * \param r    A pointer to the ring buffer index
+ * \param n    The number of elements to reserve
+ * \param pos  A pointer to where the position of the first reserved element is stored
+ * \return     Non-zero if the elements were reserved, zero if there is not room for them
+ *
+ *             The reserved elements are at array indices
+ *             (*pos & mask) and onwards, wrapping around the end of
+ *             the array. They must be committed with
+ *             ringbufindex_mpsc_commit(), as soon as they have been
+ *             written, since later producers wait for the commit.
+ */
+int ringbufindex_mpsc_reserve(struct ringbufindex_mpsc *r, int n,
+                              unsigned int *pos);
+
+/**
+ * \brief      Make reserved elements visible to the consumer
+ * \param r    A pointer to the ring buffer index
+ * \param pos  The position returned by ringbufindex_mpsc_reserve()
+ * \param n    The number of elements that were reserved
+ */
+void ringbufindex_mpsc_commit(struct ringbufindex_mpsc *r, unsigned int pos,
+                              int n);
+
+/**
+ * \brief      Get a contiguous span of elements to read
+ * \param r    A pointer to the ring buffer index
+ * \param index A pointer to where the array index of the oldest element is stored
+ * \return     The number of committed elements that follow, without wrapping, from *index
+ *
+ *             Only one thread may consume elements.
+ */
+int ringbufindex_mpsc_get_span(struct ringbufindex_mpsc *r, int *index);
+
+/**
+ * \brief      Remove a number of elements
+ * \param r    A pointer to the ring buffer index
+ * \param n    The number of elements to remove
+ */
+void ringbufindex_mpsc_get_n(struct ringbufindex_mpsc *r, int n);
+#endif /* RINGBUFINDEX_MPSC */
+
+#endif /* __RINGBUFINDEX_H__ */
+
+/** @}*/
+/** @}*/
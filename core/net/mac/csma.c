@@ -76,43 +76,133 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* The maximum number of co-existing neighbor queues */
+#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#else
+#define CSMA_MAX_NEIGHBOR_QUEUES 2
+#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
+
+#define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+
+/* The number of hash buckets used to find the queue of a neighbor, 0
+   for a linear search of the neighbor list */
+#ifdef CSMA_CONF_NEIGHBOR_HASH
+#define CSMA_NEIGHBOR_HASH CSMA_CONF_NEIGHBOR_HASH
+#else
+#define CSMA_NEIGHBOR_HASH 0
+#endif /* CSMA_CONF_NEIGHBOR_HASH */
+
+/* The maximum number of data packets queued for one neighbor, so that
+   a bulk transfer to one neighbor cannot take all packet buffers */
+#ifdef CSMA_CONF_MAX_PACKETS_PER_NEIGHBOR
+#define CSMA_MAX_PACKETS_PER_NEIGHBOR CSMA_CONF_MAX_PACKETS_PER_NEIGHBOR
+#else
+#define CSMA_MAX_PACKETS_PER_NEIGHBOR MAX_QUEUED_PACKETS
+#endif /* CSMA_CONF_MAX_PACKETS_PER_NEIGHBOR */
+
+/* The number of packet buffers that only control packets may use.
+   Control packets have PACKETBUF_ATTR_MAC_PRIORITY set or are
+   PACKETBUF_ATTR_PACKET_TYPE_ACK packets. They are queued ahead of the
+   data packets to the same neighbor. With SICSLOWPAN_CONF_PRIORITIZE_CONTROL,
+   sicslowpan sets the attribute on neighbor discovery and RPL messages. */
+#ifdef CSMA_CONF_CONTROL_RESERVE
+#define CSMA_CONTROL_RESERVE CSMA_CONF_CONTROL_RESERVE
+#else
+#define CSMA_CONTROL_RESERVE 0
+#endif /* CSMA_CONF_CONTROL_RESERVE */
+
+/* The deficit round robin quantum in bytes. If set, neighbor queues
+   that are ready to send at the same time take turns so that each
+   gets the same share of the transmitted bytes, with the queues that
+   have a control packet first. If 0, a queue sends as soon as its
+   timer expires. */
+#ifdef CSMA_CONF_DRR_QUANTUM
+#define CSMA_DRR_QUANTUM CSMA_CONF_DRR_QUANTUM
+#else
+#define CSMA_DRR_QUANTUM 0
+#endif /* CSMA_CONF_DRR_QUANTUM */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+  uint8_t control;
+  uint8_t datagram;
+#if CSMA_STATS
+  clock_time_t queued_at;
+#endif /* CSMA_STATS */
 };
 
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
   struct neighbor_queue *next;
+#if CSMA_NEIGHBOR_HASH
+  struct neighbor_queue *hash_next;
+#endif /* CSMA_NEIGHBOR_HASH */
   rimeaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+  uint8_t data_packets;
+#if CSMA_DRR_QUANTUM
+  uint8_t ready;
+  int16_t deficit;
+#endif /* CSMA_DRR_QUANTUM */
   LIST_STRUCT(queued_packet_list);
 };
 
-/* The maximum number of co-existing neighbor queues */
-#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#else
-#define CSMA_MAX_NEIGHBOR_QUEUES 2
-#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
-
-#define MAX_QUEUED_PACKETS QUEUEBUF_NUM
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
+#if CSMA_NEIGHBOR_HASH
+static struct neighbor_queue *neighbor_hash[CSMA_NEIGHBOR_HASH];
+#endif /* CSMA_NEIGHBOR_HASH */
+
+#if CSMA_DRR_QUANTUM
+/* The neighbor queue whose turn it is */
+static struct neighbor_queue *drr_next;
+static struct ctimer drr_timer;
+#endif /* CSMA_DRR_QUANTUM */
+
+#if CSMA_STATS
+static struct csma_stats stats;
+#endif /* CSMA_STATS */
+
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
 
+/*---------------------------------------------------------------------------*/
+#if CSMA_NEIGHBOR_HASH
+static struct neighbor_queue **
+neighbor_hash_bucket(const rimeaddr_t *addr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = (h << 3) ^ (h >> 13) ^ addr->u8[i];
+  }
+  return &neighbor_hash[h % CSMA_NEIGHBOR_HASH];
+}
+#endif /* CSMA_NEIGHBOR_HASH */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const rimeaddr_t *addr)
 {
+#if CSMA_NEIGHBOR_HASH
+  struct neighbor_queue *n = *neighbor_hash_bucket(addr);
+  while(n != NULL) {
+    if(rimeaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+    n = n->hash_next;
+  }
+#else /* CSMA_NEIGHBOR_HASH */
   struct neighbor_queue *n = list_head(neighbor_list);
   while(n != NULL) {
     if(rimeaddr_cmp(&n->addr, addr)) {
@@ -120,9 +210,43 @@ neighbor_queue_from_addr(const rimeaddr_t *addr)
     }
     n = list_item_next(n);
   }
+#endif /* CSMA_NEIGHBOR_HASH */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_add(struct neighbor_queue *n)
+{
+#if CSMA_NEIGHBOR_HASH
+  struct neighbor_queue **bucket = neighbor_hash_bucket(&n->addr);
+  n->hash_next = *bucket;
+  *bucket = n;
+#endif /* CSMA_NEIGHBOR_HASH */
+  list_add(neighbor_list, n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+#if CSMA_NEIGHBOR_HASH
+  struct neighbor_queue **p;
+  for(p = neighbor_hash_bucket(&n->addr); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == n) {
+      *p = n->hash_next;
+      break;
+    }
+  }
+#endif /* CSMA_NEIGHBOR_HASH */
+#if CSMA_DRR_QUANTUM
+  if(drr_next == n) {
+    drr_next = list_item_next(n);
+  }
+#endif /* CSMA_DRR_QUANTUM */
+  ctimer_stop(&n->transmit_timer);
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+}
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
 {
@@ -141,17 +265,96 @@ default_timebase(void)
 }
 /*---------------------------------------------------------------------------*/
 static void
+send_queue(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *q = list_head(n->queued_packet_list);
+  if(q != NULL) {
+    PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
+        list_length(n->queued_packet_list));
+    /* Send packets in the neighbor's list */
+    NETSTACK_RDC.send_list(packet_sent, n, q);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if CSMA_DRR_QUANTUM
+static int
+head_is_control(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *q = list_head(n->queued_packet_list);
+  return q != NULL && ((struct qbuf_metadata *)q->ptr)->control;
+}
+/*---------------------------------------------------------------------------*/
+/* Send the queue of one of the neighbors that are ready, and schedule
+   another round if more neighbors are waiting. */
+static void
+drr_schedule(void *ptr)
+{
+  struct neighbor_queue *n, *start;
+  int waiting;
+
+  /* A queue with a control packet first goes before all others. */
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(n->ready && head_is_control(n)) {
+      break;
+    }
+  }
+
+  if(n == NULL) {
+    /* Visit the ready queues in turn, adding a quantum to their
+       deficit, until one of them has a positive deficit. The sent
+       bytes are subtracted in packet_sent(). */
+    if(drr_next == NULL) {
+      drr_next = list_head(neighbor_list);
+    }
+    start = drr_next;
+    waiting = 0;
+    while(drr_next != NULL) {
+      if(drr_next->ready) {
+        if(drr_next->deficit > 0) {
+          n = drr_next;
+          break;
+        }
+        drr_next->deficit += CSMA_DRR_QUANTUM;
+        waiting = 1;
+      }
+      drr_next = list_item_next(drr_next);
+      if(drr_next == NULL) {
+        drr_next = list_head(neighbor_list);
+      }
+      if(drr_next == start && !waiting) {
+        /* No queue is ready. */
+        return;
+      }
+    }
+  }
+
+  if(n != NULL) {
+    n->ready = 0;
+    send_queue(n);
+  }
+
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(n->ready) {
+      ctimer_set(&drr_timer, 0, drr_schedule, NULL);
+      break;
+    }
+  }
+}
+#endif /* CSMA_DRR_QUANTUM */
+/*---------------------------------------------------------------------------*/
+static void
 transmit_packet_list(void *ptr)
 {
   struct neighbor_queue *n = ptr;
   if(n) {
-    struct rdc_buf_list *q = list_head(n->queued_packet_list);
-    if(q != NULL) {
-      PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
-          list_length(n->queued_packet_list));
-      /* Send packets in the neighbor's list */
-      NETSTACK_RDC.send_list(packet_sent, n, q);
-    }
+#if CSMA_DRR_QUANTUM
+    /* Let the other queues whose timers expire now become ready
+       before choosing which one to send. */
+    n->ready = 1;
+    ctimer_set(&drr_timer, 0, drr_schedule, NULL);
+#else /* CSMA_DRR_QUANTUM */
+    send_queue(n);
+#endif /* CSMA_DRR_QUANTUM */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -159,9 +362,24 @@ static void
 free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
 {
   if(p != NULL) {
+    struct qbuf_metadata *metadata = (struct qbuf_metadata *)p->ptr;
     /* Remove packet from list and deallocate */
     list_remove(n->queued_packet_list, p);
 
+    if(!metadata->control) {
+      n->data_packets--;
+    }
+#if CSMA_STATS
+    {
+      clock_time_t sojourn = clock_time() - metadata->queued_at;
+      stats.dequeued++;
+      stats.queue_len--;
+      stats.sojourn_total += sojourn;
+      if(sojourn > stats.sojourn_max) {
+        stats.sojourn_max = sojourn;
+      }
+    }
+#endif /* CSMA_STATS */
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
     memb_free(&packet_memb, p);
@@ -177,9 +395,38 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
                  transmit_packet_list, n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The parts of a datagram, such as 6lowpan fragments, are queued with
+   PACKETBUF_ATTR_MAC_DATAGRAM set and the same callback pointer. When
+   one part is dropped the receiver cannot reassemble the datagram, so
+   the parts that are still queued are dropped too instead of using
+   the channel. */
+static void
+drop_datagram(struct neighbor_queue *n, struct rdc_buf_list *failed)
+{
+  struct qbuf_metadata *f = (struct qbuf_metadata *)failed->ptr;
+  struct qbuf_metadata *metadata;
+  struct rdc_buf_list *q, *next;
+  mac_callback_t sent;
+  void *cptr;
+
+  if(!f->datagram) {
+    return;
+  }
+  for(q = list_head(n->queued_packet_list); q != NULL; q = next) {
+    next = list_item_next(q);
+    metadata = (struct qbuf_metadata *)q->ptr;
+    if(q != failed && metadata->datagram &&
+       metadata->sent == f->sent && metadata->cptr == f->cptr) {
+      PRINTF("csma: drop the rest of a failed datagram\n");
+      sent = metadata->sent;
+      cptr = metadata->cptr;
+      free_packet(n, q);
+      mac_call_sent_callback(sent, cptr, MAC_TX_ERR, 0);
     }
   }
 }
@@ -212,6 +459,9 @@ packet_sent(void *ptr, int status, int num_transmissions)
     n->deferrals++;
     break;
   }
+#if CSMA_DRR_QUANTUM
+  n->deficit -= packetbuf_totlen();
+#endif /* CSMA_DRR_QUANTUM */
 
   for(q = list_head(n->queued_packet_list);
       q != NULL; q = list_item_next(q)) {
@@ -273,6 +523,7 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+          drop_datagram(n, q);
           free_packet(n, q);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -281,6 +532,7 @@ packet_sent(void *ptr, int status, int num_transmissions)
           PRINTF("csma: rexmit ok %d\n", n->transmissions);
         } else {
           PRINTF("csma: rexmit failed %d: %d\n", n->transmissions, status);
+          drop_datagram(n, q);
         }
         free_packet(n, q);
         mac_call_sent_callback(sent, cptr, status, num_tx);
@@ -289,6 +541,28 @@ packet_sent(void *ptr, int status, int num_transmissions)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Queue a control packet after the other control packets, ahead of the
+   data packets. A packet that is already being transmitted stays
+   first. */
+static void
+enqueue_control(struct neighbor_queue *n, struct rdc_buf_list *q)
+{
+  struct rdc_buf_list *prev, *next;
+
+  prev = NULL;
+  next = list_head(n->queued_packet_list);
+  if(next != NULL &&
+     (n->transmissions > 0 || n->collisions > 0 || n->deferrals > 0)) {
+    prev = next;
+    next = list_item_next(next);
+  }
+  while(next != NULL && ((struct qbuf_metadata *)next->ptr)->control) {
+    prev = next;
+    next = list_item_next(next);
+  }
+  list_insert(n->queued_packet_list, prev, q);
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
@@ -296,6 +570,11 @@ send_packet(mac_callback_t sent, void *ptr)
   struct neighbor_queue *n;
   static uint16_t seqno;
   const rimeaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t control;
+
+  control = packetbuf_attr(PACKETBUF_ATTR_MAC_PRIORITY) != 0 ||
+    packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
+    PACKETBUF_ATTR_PACKET_TYPE_ACK;
 
   if(seqno == 0) {
     /* PACKETBUF_ATTR_MAC_SEQNO cannot be zero, due to a pecuilarity
@@ -315,16 +594,30 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+      n->data_packets = 0;
+#if CSMA_DRR_QUANTUM
+      n->ready = 0;
+      n->deficit = 0;
+#endif /* CSMA_DRR_QUANTUM */
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
-      list_add(neighbor_list, n);
+      neighbor_queue_add(n);
     }
   }
 
   if(n != NULL) {
-    /* Add packet to the neighbor's queue */
-    q = memb_alloc(&packet_memb);
+    /* Add packet to the neighbor's queue. Data packets may not use
+       more than their share of the buffers. */
+    q = NULL;
+    if(control ||
+       (n->data_packets < CSMA_MAX_PACKETS_PER_NEIGHBOR
+#if CSMA_CONTROL_RESERVE
+        && memb_numfree(&packet_memb) > CSMA_CONTROL_RESERVE
+#endif /* CSMA_CONTROL_RESERVE */
+        )) {
+      q = memb_alloc(&packet_memb);
+    }
     if(q != NULL) {
       q->ptr = memb_alloc(&metadata_memb);
       if(q->ptr != NULL) {
@@ -341,11 +634,21 @@ send_packet(mac_callback_t sent, void *ptr)
 	  }
 	  metadata->sent = sent;
 	  metadata->cptr = ptr;
+	  metadata->control = control;
+	  metadata->datagram = ptr != NULL &&
+	    packetbuf_attr(PACKETBUF_ATTR_MAC_DATAGRAM) != 0;
+#if CSMA_STATS
+	  metadata->queued_at = clock_time();
+	  stats.queued++;
+	  if(++stats.queue_len > stats.max_queue_len) {
+	    stats.max_queue_len = stats.queue_len;
+	  }
+#endif /* CSMA_STATS */
 
-	  if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
-	     PACKETBUF_ATTR_PACKET_TYPE_ACK) {
-	    list_push(n->queued_packet_list, q);
+	  if(control) {
+	    enqueue_control(n, q);
 	  } else {
+	    n->data_packets++;
 	    list_add(n->queued_packet_list, q);
 	  }
 
@@ -363,13 +666,15 @@ send_packet(mac_callback_t sent, void *ptr)
     }
     /* The packet allocation failed. Remove and free neighbor entry if empty. */
     if(list_length(n->queued_packet_list) == 0) {
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+#if CSMA_STATS
+  stats.dropped++;
+#endif /* CSMA_STATS */
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
@@ -400,6 +705,14 @@ channel_check_interval(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_STATS
+void
+csma_get_stats(struct csma_stats *s)
+{
+  *s = stats;
+}
+#endif /* CSMA_STATS */
+/*---------------------------------------------------------------------------*/
 static void
 init(void)
 {
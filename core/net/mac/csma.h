@@ -43,6 +43,31 @@
 
 #include "net/mac/mac.h"
 #include "dev/radio.h"
+#include "sys/clock.h"
+
+#ifdef CSMA_CONF_STATS
+#define CSMA_STATS CSMA_CONF_STATS
+#else /* CSMA_CONF_STATS */
+#define CSMA_STATS 0
+#endif /* CSMA_CONF_STATS */
+
+#if CSMA_STATS
+struct csma_stats {
+  /** Packets put in a neighbor queue. */
+  unsigned long queued;
+  /** Packets dropped because no buffer or neighbor queue was free. */
+  unsigned long dropped;
+  /** Packets that left their queue, sent or given up on. */
+  unsigned long dequeued;
+  /** Packets in the queues now, and the most there have been. */
+  uint16_t queue_len, max_queue_len;
+  /** Total and longest time the dequeued packets spent queued. */
+  unsigned long sojourn_total;
+  clock_time_t sojourn_max;
+};
+
+void csma_get_stats(struct csma_stats *stats);
+#endif /* CSMA_STATS */
 
 extern const struct mac_driver csma_driver;
 
@@ -46,6 +46,11 @@
 #include "dev/watchdog.h"
 #include "dev/leds.h"
 
+#include <string.h>
+#if PHASE_CACHE
+#include "cfs/cfs.h"
+#endif /* PHASE_CACHE */
+
 struct phase_queueitem {
   struct ctimer timer;
   mac_callback_t mac_callback;
@@ -63,6 +68,35 @@ struct phase_queueitem {
 
 MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 
+#if PHASE_CACHE
+#ifdef PHASE_CONF_CACHE_FILE
+#define PHASE_CACHE_FILE      PHASE_CONF_CACHE_FILE
+#else
+#define PHASE_CACHE_FILE      "phases"
+#endif
+
+/* The time from a change of the neighbors in the phase list until the
+   phases are saved, so that changes close in time are saved together */
+#ifdef PHASE_CONF_CACHE_DELAY
+#define PHASE_CACHE_DELAY     PHASE_CONF_CACHE_DELAY
+#else
+#define PHASE_CACHE_DELAY     (CLOCK_SECOND * 60)
+#endif
+
+struct phase_record {
+  rimeaddr_t neighbor;
+  rtimer_clock_t time;
+};
+
+static struct ctimer cache_timer;
+#endif /* PHASE_CACHE */
+
+#if PHASE_ADAPTIVE_GUARD
+/* The weight, in 1/4, of the old estimate of how early a neighbor
+   wakes up */
+#define EARLY_ALPHA           3
+#endif /* PHASE_ADAPTIVE_GUARD */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -73,11 +107,30 @@ MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+#if PHASE_HASH_SIZE
+static struct phase **
+hash_bucket(const struct phase_list *list, const rimeaddr_t *addr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = (h << 3) ^ (h >> 13) ^ addr->u8[i];
+  }
+  return &list->hash[h % PHASE_HASH_SIZE];
+}
+#endif /* PHASE_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
 struct phase *
 find_neighbor(const struct phase_list *list, const rimeaddr_t *addr)
 {
   struct phase *e;
+#if PHASE_HASH_SIZE
+  for(e = *hash_bucket(list, addr); e != NULL; e = e->hash_next) {
+#else /* PHASE_HASH_SIZE */
   for(e = list_head(*list->list); e != NULL; e = list_item_next(e)) {
+#endif /* PHASE_HASH_SIZE */
     if(rimeaddr_cmp(addr, &e->neighbor)) {
       return e;
     }
@@ -85,14 +138,137 @@ find_neighbor(const struct phase_list *list, const rimeaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Take a phase out of the list, without freeing it. */
+static void
+unlink_phase(const struct phase_list *list, struct phase *e)
+{
+#if PHASE_HASH_SIZE
+  struct phase **p;
+  for(p = hash_bucket(list, &e->neighbor); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == e) {
+      *p = e->hash_next;
+      break;
+    }
+  }
+#endif /* PHASE_HASH_SIZE */
+  list_remove(*list->list, e);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_phase(const struct phase_list *list, struct phase *e)
+{
+#if PHASE_HASH_SIZE
+  struct phase **bucket = hash_bucket(list, &e->neighbor);
+  e->hash_next = *bucket;
+  *bucket = e;
+#endif /* PHASE_HASH_SIZE */
+  list_push(*list->list, e);
+}
+/*---------------------------------------------------------------------------*/
+#if PHASE_CACHE
+static void
+save_phases(void *ptr)
+{
+  const struct phase_list *list = ptr;
+  struct phase_record r;
+  struct phase *e;
+  int fd;
+
+  cfs_remove(PHASE_CACHE_FILE);
+  fd = cfs_open(PHASE_CACHE_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("phase: could not open %s\n", PHASE_CACHE_FILE);
+    return;
+  }
+  for(e = list_head(*list->list); e != NULL; e = list_item_next(e)) {
+    if(e->restored) {
+      /* Not anchored yet, so the time is not in our rtimer base. */
+      continue;
+    }
+    rimeaddr_copy(&r.neighbor, &e->neighbor);
+    r.time = e->time;
+    if(cfs_write(fd, &r, sizeof(r)) != sizeof(r)) {
+      break;
+    }
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_save(const struct phase_list *list)
+{
+  if(ctimer_expired(&cache_timer)) {
+    ctimer_set(&cache_timer, PHASE_CACHE_DELAY, save_phases, (void *)list);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * The saved phases are times of the rtimer before the reboot. The
+ * offset between the old and the new rtimer is the same for all
+ * neighbors, so when the phase of one of them has been found again
+ * the phases of the others follow from it.
+ */
+static void
+restore_phases(const struct phase_list *list)
+{
+  struct phase_record r;
+  struct phase *e;
+  int fd;
+
+  fd = cfs_open(PHASE_CACHE_FILE, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+  while(cfs_read(fd, &r, sizeof(r)) == sizeof(r)) {
+    if(find_neighbor(list, &r.neighbor) != NULL) {
+      continue;
+    }
+    e = memb_alloc(list->memb);
+    if(e == NULL) {
+      break;
+    }
+    rimeaddr_copy(&e->neighbor, &r.neighbor);
+    e->time = r.time;
+#if PHASE_DRIFT_CORRECT
+    e->drift = 0;
+#endif
+#if PHASE_ADAPTIVE_GUARD
+    e->seen = clock_time();
+    e->cycles = 0;
+    e->early = 0;
+#endif
+    e->noacks = 0;
+    e->restored = 1;
+    add_phase(list, e);
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+anchor_phases(const struct phase_list *list, rtimer_clock_t offset)
+{
+  struct phase *e;
+
+  for(e = list_head(*list->list); e != NULL; e = list_item_next(e)) {
+    if(e->restored) {
+      e->time += offset;
+      e->restored = 0;
+    }
+  }
+}
+#endif /* PHASE_CACHE */
+/*---------------------------------------------------------------------------*/
 void
 phase_remove(const struct phase_list *list, const rimeaddr_t *neighbor)
 {
   struct phase *e;
   e = find_neighbor(list, neighbor);
   if(e != NULL) {
-    list_remove(*list->list, e);
+    unlink_phase(list, e);
     memb_free(list->memb, e);
+#if PHASE_CACHE
+    schedule_save(list);
+#endif /* PHASE_CACHE */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -107,6 +283,43 @@ phase_update(const struct phase_list *list,
   e = find_neighbor(list, neighbor);
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
+#if PHASE_CACHE
+      if(e->restored) {
+        /* The first phase found after a reboot gives the offset of
+           all the restored phases. */
+        anchor_phases(list, time - e->time);
+      }
+#endif /* PHASE_CACHE */
+#if PHASE_ADAPTIVE_GUARD
+      if(e->cycles > 0) {
+        /* A neighbor that wakes up later than expected costs nothing
+           more than a few strobes, but one that wakes up earlier than
+           the guard time is missed. */
+        uint32_t early;
+        rtimer_clock_t ahead;
+
+        /* How much earlier than expected the neighbor woke up, modulo
+           the cycle time. A neighbor that woke up before the guard
+           time is caught about a cycle later, so an offset of more
+           than half a cycle past the expected time is early too. */
+        if(RTIMER_CLOCK_LT(time, e->expected)) {
+          ahead = (rtimer_clock_t)(e->expected - time) % e->cycle_time;
+        } else {
+          ahead = (rtimer_clock_t)(time - e->expected) % e->cycle_time;
+          ahead = ahead > 0 ? e->cycle_time - ahead : 0;
+        }
+        early = 0;
+        if(ahead < e->cycle_time / 2) {
+          early = ((uint32_t)ahead << 8) / e->cycles;
+          if(early > 0xffff) {
+            early = 0xffff;
+          }
+        }
+        e->early = ((uint32_t)e->early * EARLY_ALPHA + early) / 4;
+        e->cycles = 0;
+      }
+      e->seen = clock_time();
+#endif /* PHASE_ADAPTIVE_GUARD */
 #if PHASE_DRIFT_CORRECT
       e->drift = time-e->time;
 #endif
@@ -123,8 +336,11 @@ phase_update(const struct phase_list *list,
       }
       if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
         PRINTF("drop %d\n", neighbor->u8[0]);
-        list_remove(*list->list, e);
+        unlink_phase(list, e);
         memb_free(list->memb, e);
+#if PHASE_CACHE
+        schedule_save(list);
+#endif /* PHASE_CACHE */
         return;
       }
     } else if(mac_status == MAC_TX_OK) {
@@ -138,15 +354,25 @@ phase_update(const struct phase_list *list,
         PRINTF("phase alloc NULL\n");
         /* We could not allocate memory for this phase, so we drop
            the last item on the list and reuse it for our phase. */
-        e = list_chop(*list->list);
+        e = list_tail(*list->list);
+        unlink_phase(list, e);
       }
       rimeaddr_copy(&e->neighbor, neighbor);
       e->time = time;
 #if PHASE_DRIFT_CORRECT
       e->drift = 0;
+#endif
+#if PHASE_ADAPTIVE_GUARD
+      e->seen = clock_time();
+      e->cycles = 0;
+      e->early = 0;
 #endif
       e->noacks = 0;
-      list_push(*list->list, e);
+#if PHASE_CACHE
+      e->restored = 0;
+      schedule_save(list);
+#endif /* PHASE_CACHE */
+      add_phase(list, e);
     }
   }
 }
@@ -181,6 +407,13 @@ phase_wait(struct phase_list *list,
      time for the next expected phase and setup a ctimer to switch on
      the radio just before the phase. */
   e = find_neighbor(list, neighbor);
+#if PHASE_CACHE
+  if(e != NULL && e->restored) {
+    /* The phase is not known until one neighbor has been found again
+       after the reboot. */
+    e = NULL;
+  }
+#endif /* PHASE_CACHE */
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
@@ -223,9 +456,34 @@ phase_wait(struct phase_list *list,
       wait = cycle_time - (rtimer_clock_t)((now - sync) % cycle_time);
     }
 
+#if PHASE_ADAPTIVE_GUARD
+    {
+      uint32_t cycles, extra;
+
+      /* The number of cycles from the last time the phase was seen
+         to the expected wake-up. This is counted with the clock, as
+         the rtimer may wrap around within a few cycles. */
+      cycles = (uint32_t)(clock_time() - e->seen) *
+        (RTIMER_ARCH_SECOND / cycle_time) / CLOCK_SECOND + 1;
+      extra = ((uint32_t)e->early * cycles) >> 8;
+      if(guard_time + extra > cycle_time / 2) {
+        extra = guard_time < cycle_time / 2 ? cycle_time / 2 - guard_time : 0;
+      }
+      guard_time += extra;
+      if(wait < guard_time) {
+        cycles++;
+      }
+      e->cycles = cycles > 0xffff ? 0xffff : cycles;
+    }
+#endif /* PHASE_ADAPTIVE_GUARD */
+
     if(wait < guard_time) {
       wait += cycle_time;
     }
+#if PHASE_ADAPTIVE_GUARD
+    e->expected = now + wait;
+    e->cycle_time = cycle_time;
+#endif /* PHASE_ADAPTIVE_GUARD */
 
     ctimewait = (CLOCK_SECOND * (wait - guard_time)) / RTIMER_ARCH_SECOND;
 
@@ -264,5 +522,11 @@ phase_init(struct phase_list *list)
   list_init(*list->list);
   memb_init(list->memb);
   memb_init(&queued_packets_memb);
+#if PHASE_HASH_SIZE
+  memset(list->hash, 0, PHASE_HASH_SIZE * sizeof(struct phase *));
+#endif /* PHASE_HASH_SIZE */
+#if PHASE_CACHE
+  restore_phases(list);
+#endif /* PHASE_CACHE */
 }
 /*---------------------------------------------------------------------------*/
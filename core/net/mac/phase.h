@@ -53,20 +53,60 @@
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* The number of hash buckets used to find the phase of a neighbor, 0
+   for a linear search of the phase list */
+#if PHASE_CONF_HASH_SIZE
+#define PHASE_HASH_SIZE PHASE_CONF_HASH_SIZE
+#else
+#define PHASE_HASH_SIZE 0
+#endif
+
+/* Widen the guard time for neighbors that have woken up earlier than
+   expected, in proportion to the number of cycles since their phase
+   was last seen */
+#if PHASE_CONF_ADAPTIVE_GUARD
+#define PHASE_ADAPTIVE_GUARD PHASE_CONF_ADAPTIVE_GUARD
+#else
+#define PHASE_ADAPTIVE_GUARD 0
+#endif
+
+/* Save the learned phases in a CFS file, and restore them at boot */
+#if PHASE_CONF_CACHE
+#define PHASE_CACHE PHASE_CONF_CACHE
+#else
+#define PHASE_CACHE 0
+#endif
+
 struct phase {
   struct phase *next;
+#if PHASE_HASH_SIZE
+  struct phase *hash_next;
+#endif
   rimeaddr_t neighbor;
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
   rtimer_clock_t drift;
+#endif
+#if PHASE_ADAPTIVE_GUARD
+  rtimer_clock_t expected;
+  rtimer_clock_t cycle_time;
+  clock_time_t seen;
+  uint16_t cycles;
+  uint16_t early;
 #endif
   uint8_t noacks;
+#if PHASE_CACHE
+  uint8_t restored;
+#endif
   struct timer noacks_timer;
 };
 
 struct phase_list {
   list_t *list;
   struct memb *memb;
+#if PHASE_HASH_SIZE
+  struct phase **hash;
+#endif
 };
 
 typedef enum {
@@ -76,9 +116,17 @@ typedef enum {
 } phase_status_t;
 
 
+#if PHASE_HASH_SIZE
+#define PHASE_LIST(name, num) LIST(phase_list_list);                              \
+                              MEMB(phase_list_memb, struct phase, num);           \
+                              static struct phase *phase_list_hash[PHASE_HASH_SIZE]; \
+                              struct phase_list name = { &phase_list_list, &phase_list_memb, \
+                                                         phase_list_hash }
+#else
 #define PHASE_LIST(name, num) LIST(phase_list_list);                              \
                               MEMB(phase_list_memb, struct phase, num);           \
                               struct phase_list name = { &phase_list_list, &phase_list_memb }
+#endif
 
 void phase_init(struct phase_list *list);
 phase_status_t phase_wait(struct phase_list *list,  const rimeaddr_t *neighbor,
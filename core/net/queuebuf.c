@@ -75,6 +75,28 @@ struct queuebuf {
 #endif
 };
 
+#if QUEUEBUF_SMALL_NUM
+/* The actual queuebuf data: the frame, followed by an entry for each
+   attribute and address that is set. An attribute entry is its type
+   and value, an address entry is its type and the address. */
+#define ATTR_ENTRY_SIZE (1 + sizeof(packetbuf_attr_t))
+#define ADDR_ENTRY_SIZE (1 + sizeof(rimeaddr_t))
+#define SMALL_DATA_SIZE (QUEUEBUF_SMALL_SIZE - 4)
+struct queuebuf_data {
+  uint16_t len;
+  uint8_t nattrs, naddrs;
+  uint8_t data[PACKETBUF_SIZE +
+               PACKETBUF_NUM_ATTRS * ATTR_ENTRY_SIZE +
+               PACKETBUF_NUM_ADDRS * ADDR_ENTRY_SIZE];
+};
+
+/* A shorter version of struct queuebuf_data, for short frames. */
+struct queuebuf_small_data {
+  uint16_t len;
+  uint8_t nattrs, naddrs;
+  uint8_t data[SMALL_DATA_SIZE];
+};
+#else /* QUEUEBUF_SMALL_NUM */
 /* The actual queuebuf data */
 struct queuebuf_data {
   uint16_t len;
@@ -82,6 +104,7 @@ struct queuebuf_data {
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
 };
+#endif /* QUEUEBUF_SMALL_NUM */
 
 struct queuebuf_ref {
   uint16_t len;
@@ -93,6 +116,9 @@ struct queuebuf_ref {
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
 MEMB(refbufmem, struct queuebuf_ref, QUEUEBUF_REF_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+#if QUEUEBUF_SMALL_NUM
+MEMB(bufsmallmem, struct queuebuf_small_data, QUEUEBUF_SMALL_NUM);
+#endif /* QUEUEBUF_SMALL_NUM */
 
 #if WITH_SWAP
 
@@ -288,6 +314,136 @@ queuebuf_load_to_ram(struct queuebuf *b)
   return b->ram_ptr;
 }
 #endif /* WITH_SWAP */
+#if QUEUEBUF_SMALL_NUM
+/*---------------------------------------------------------------------------*/
+/* The number of bytes needed to store the attributes and addresses
+   that are set in packetbuf. */
+static int
+attrs_size(void)
+{
+  int i, size;
+
+  size = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    if(packetbuf_attr(i) != 0) {
+      size += ATTR_ENTRY_SIZE;
+    }
+  }
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+    if(!rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_FIRST + i),
+                     &rimeaddr_null)) {
+      size += ADDR_ENTRY_SIZE;
+    }
+  }
+  return size;
+}
+/*---------------------------------------------------------------------------*/
+static int
+data_capacity(struct queuebuf_data *d)
+{
+  if(memb_inmemb(&bufsmallmem, d)) {
+    return SMALL_DATA_SIZE;
+  }
+  return sizeof(d->data);
+}
+/*---------------------------------------------------------------------------*/
+static struct queuebuf_data *
+data_alloc(int size)
+{
+  struct queuebuf_data *d = NULL;
+
+  if(size <= SMALL_DATA_SIZE) {
+    d = memb_alloc(&bufsmallmem);
+  }
+  if(d == NULL) {
+    d = memb_alloc(&buframmem);
+  }
+  return d;
+}
+/*---------------------------------------------------------------------------*/
+static void
+data_free(struct queuebuf_data *d)
+{
+  if(memb_inmemb(&bufsmallmem, d)) {
+    memb_free(&bufsmallmem, d);
+  } else {
+    memb_free(&buframmem, d);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Store the attributes and addresses that are set in packetbuf after
+   the frame. */
+static void
+attrs_copyto(struct queuebuf_data *d)
+{
+  packetbuf_attr_t val;
+  uint8_t *p;
+  int i;
+
+  p = &d->data[d->len];
+  d->nattrs = d->naddrs = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    if(packetbuf_attr(i) != 0) {
+      p[0] = i;
+      val = packetbuf_attr(i);
+      memcpy(&p[1], &val, sizeof(packetbuf_attr_t));
+      p += ATTR_ENTRY_SIZE;
+      d->nattrs++;
+    }
+  }
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+    if(!rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_FIRST + i),
+                     &rimeaddr_null)) {
+      p[0] = PACKETBUF_ADDR_FIRST + i;
+      rimeaddr_copy((rimeaddr_t *)&p[1],
+                    packetbuf_addr(PACKETBUF_ADDR_FIRST + i));
+      p += ADDR_ENTRY_SIZE;
+      d->naddrs++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+attrs_copyfrom(struct queuebuf_data *d)
+{
+  packetbuf_attr_t val;
+  uint8_t *p;
+  int i;
+
+  p = &d->data[d->len];
+  for(i = 0; i < d->nattrs; i++) {
+    memcpy(&val, &p[1], sizeof(packetbuf_attr_t));
+    packetbuf_set_attr(p[0], val);
+    p += ATTR_ENTRY_SIZE;
+  }
+  for(i = 0; i < d->naddrs; i++) {
+    packetbuf_set_addr(p[0], (rimeaddr_t *)&p[1]);
+    p += ADDR_ENTRY_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Find the entry of an attribute or address, or return NULL if it was
+   not set. */
+static uint8_t *
+attr_entry(struct queuebuf_data *d, uint8_t type)
+{
+  uint8_t *p;
+  int i;
+
+  p = &d->data[d->len];
+  for(i = 0; i < d->nattrs; i++, p += ATTR_ENTRY_SIZE) {
+    if(p[0] == type) {
+      return p;
+    }
+  }
+  for(i = 0; i < d->naddrs; i++, p += ADDR_ENTRY_SIZE) {
+    if(p[0] == type) {
+      return p;
+    }
+  }
+  return NULL;
+}
+#endif /* QUEUEBUF_SMALL_NUM */
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
@@ -302,6 +458,9 @@ queuebuf_init(void)
   memb_init(&buframmem);
   memb_init(&bufmem);
   memb_init(&refbufmem);
+#if QUEUEBUF_SMALL_NUM
+  memb_init(&bufsmallmem);
+#endif /* QUEUEBUF_SMALL_NUM */
 #if QUEUEBUF_STATS
   queuebuf_max_len = QUEUEBUF_NUM;
 #endif /* QUEUEBUF_STATS */
@@ -341,7 +500,11 @@ queuebuf_new_from_packetbuf(void)
       buf->line = line;
       buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_SMALL_NUM
+      buf->ram_ptr = data_alloc(packetbuf_totlen() + attrs_size());
+#else /* QUEUEBUF_SMALL_NUM */
       buf->ram_ptr = memb_alloc(&buframmem);
+#endif /* QUEUEBUF_SMALL_NUM */
 #if WITH_SWAP
       /* If the allocation failed, store the qbuf in swap files */
       if(buf->ram_ptr != NULL) {
@@ -356,13 +519,21 @@ queuebuf_new_from_packetbuf(void)
 #else
       if(buf->ram_ptr == NULL) {
         PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
+#if QUEUEBUF_DEBUG
+        list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
+        memb_free(&bufmem, buf);
         return NULL;
       }
       buframptr = buf->ram_ptr;
 #endif
 
       buframptr->len = packetbuf_copyto(buframptr->data);
+#if QUEUEBUF_SMALL_NUM
+      attrs_copyto(buframptr);
+#else /* QUEUEBUF_SMALL_NUM */
       packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#endif /* QUEUEBUF_SMALL_NUM */
 
 #if WITH_SWAP
       if(buf->location == IN_CFS) {
@@ -396,7 +567,28 @@ void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+#if QUEUEBUF_SMALL_NUM
+  struct queuebuf_data *newptr;
+  int size = buframptr->len + attrs_size();
+
+  if(size > data_capacity(buframptr)) {
+    /* The attributes do not fit after the frame, so the data is moved
+       to a larger buffer. If there is none, the old attributes are
+       kept. */
+    newptr = data_alloc(size);
+    if(newptr == NULL) {
+      PRINTF("queuebuf_update_attr_from_packetbuf: could not allocate data\n");
+      return;
+    }
+    newptr->len = buframptr->len;
+    memcpy(newptr->data, buframptr->data, buframptr->len);
+    data_free(buframptr);
+    buf->ram_ptr = buframptr = newptr;
+  }
+  attrs_copyto(buframptr);
+#else /* QUEUEBUF_SMALL_NUM */
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#endif /* QUEUEBUF_SMALL_NUM */
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -415,7 +607,11 @@ queuebuf_free(struct queuebuf *buf)
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
+#if QUEUEBUF_SMALL_NUM
+    data_free(buf->ram_ptr);
+#else /* QUEUEBUF_SMALL_NUM */
     memb_free(&buframmem, buf->ram_ptr);
+#endif /* QUEUEBUF_SMALL_NUM */
 #endif
     memb_free(&bufmem, buf);
 #if QUEUEBUF_STATS
@@ -440,7 +636,11 @@ queuebuf_to_packetbuf(struct queuebuf *b)
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
+#if QUEUEBUF_SMALL_NUM
+    attrs_copyfrom(buframptr);
+#else /* QUEUEBUF_SMALL_NUM */
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+#endif /* QUEUEBUF_SMALL_NUM */
   } else if(memb_inmemb(&refbufmem, b)) {
     r = (struct queuebuf_ref *)b;
     packetbuf_clear();
@@ -476,14 +676,32 @@ rimeaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if QUEUEBUF_SMALL_NUM
+  uint8_t *p = attr_entry(buframptr, type);
+  if(p == NULL) {
+    return (rimeaddr_t *)&rimeaddr_null;
+  }
+  return (rimeaddr_t *)&p[1];
+#else /* QUEUEBUF_SMALL_NUM */
   return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+#endif /* QUEUEBUF_SMALL_NUM */
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if QUEUEBUF_SMALL_NUM
+  packetbuf_attr_t val;
+  uint8_t *p = attr_entry(buframptr, type);
+  if(p == NULL) {
+    return 0;
+  }
+  memcpy(&val, &p[1], sizeof(packetbuf_attr_t));
+  return val;
+#else /* QUEUEBUF_SMALL_NUM */
   return buframptr->attrs[type].val;
+#endif /* QUEUEBUF_SMALL_NUM */
 }
 /*---------------------------------------------------------------------------*/
 void
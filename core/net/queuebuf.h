@@ -62,6 +62,25 @@
 #define QUEUEBUF_NUM 8
 #endif
 
+/* QUEUEBUF_SMALL_NUM is the number of small queuebuf data buffers of
+   QUEUEBUF_SMALL_SIZE bytes. If it is set, queuebufs store only the
+   frame and the attributes that are set, so that short frames fit in
+   the small buffers. Frames that do not fit use one of the
+   QUEUEBUFRAM_NUM full-size buffers. Swapping is not supported in
+   this mode: QUEUEBUF_NUM should be QUEUEBUFRAM_NUM +
+   QUEUEBUF_SMALL_NUM. */
+#ifdef QUEUEBUF_CONF_SMALL_NUM
+#define QUEUEBUF_SMALL_NUM QUEUEBUF_CONF_SMALL_NUM
+#else
+#define QUEUEBUF_SMALL_NUM 0
+#endif
+
+#ifdef QUEUEBUF_CONF_SMALL_SIZE
+#define QUEUEBUF_SMALL_SIZE QUEUEBUF_CONF_SMALL_SIZE
+#else
+#define QUEUEBUF_SMALL_SIZE 48
+#endif
+
 /* QUEUEBUFRAM_NUM is the number of queuebufs stored in RAM.
    If QUEUEBUFRAM_CONF_NUM is set lower than QUEUEBUF_NUM,
    swapping is enabled and queuebufs are stored either in RAM of CFS.
@@ -72,7 +91,7 @@
     #error "QUEUEBUFRAM_CONF_NUM cannot be greater than QUEUEBUF_NUM"
   #else
     #define QUEUEBUFRAM_NUM QUEUEBUFRAM_CONF_NUM
-    #define WITH_SWAP (QUEUEBUFRAM_NUM < QUEUEBUF_NUM)
+    #define WITH_SWAP (QUEUEBUFRAM_NUM < QUEUEBUF_NUM && QUEUEBUF_SMALL_NUM == 0)
   #endif
 #else /* QUEUEBUFRAM_CONF_NUM */
   #define QUEUEBUFRAM_NUM QUEUEBUF_NUM
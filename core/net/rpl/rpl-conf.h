@@ -184,4 +184,27 @@
 #define RPL_DEFAULT_LIFETIME            RPL_CONF_DEFAULT_LIFETIME
 #endif
 
+/*
+ * Non-storing mode of operation (RFC 6550, RFC 6554). The nodes send
+ * their DAOs to the DAG root, which keeps the parent of every node
+ * and routes downward traffic with source routing headers. The other
+ * nodes need no routes for their descendants. Enabling it makes
+ * non-storing the default mode of operation.
+ */
+#ifdef RPL_CONF_WITH_NON_STORING
+#define RPL_WITH_NON_STORING RPL_CONF_WITH_NON_STORING
+#else
+#define RPL_WITH_NON_STORING 0
+#endif /* RPL_CONF_WITH_NON_STORING */
+
+/*
+ * The number of nodes the DAG root can keep in its non-storing mode
+ * graph, including nodes only known as the parent of another node.
+ */
+#ifdef RPL_NS_CONF_LINK_NUM
+#define RPL_NS_LINK_NUM RPL_NS_CONF_LINK_NUM
+#else
+#define RPL_NS_LINK_NUM UIP_DS6_ROUTE_NB
+#endif /* RPL_NS_CONF_LINK_NUM */
+
 #endif /* RPL_CONF_H */
@@ -69,6 +69,15 @@ static rpl_of_t * const objective_functions[] = {&RPL_OF};
 #define RPL_MAX_PARENTS_PER_DAG       RPL_CONF_MAX_PARENTS_PER_DAG
 #endif /* !RPL_CONF_MAX_PARENTS_PER_DAG */
 
+/* The change in the rank that is needed to update the rank of the
+   node when the preferred parent stays the same. 0 updates the rank on
+   every change of the link metric or of the parent rank. */
+#ifndef RPL_CONF_RANK_THRESHOLD
+#define RPL_RANK_THRESHOLD            0
+#else
+#define RPL_RANK_THRESHOLD            RPL_CONF_RANK_THRESHOLD
+#endif /* !RPL_CONF_RANK_THRESHOLD */
+
 /*---------------------------------------------------------------------------*/
 /* RPL definitions. */
 
@@ -103,6 +112,36 @@ lollipop_greater_than(int a, int b)
 			 RPL_LOLLIPOP_SEQUENCE_WINDOWS));
 }
 /*---------------------------------------------------------------------------*/
+/* Move a parent whose metrics changed to its place in the parent list
+   of the DAG, which is kept ordered by the path cost of the objective
+   function, with the parents of infinite rank last. */
+static void
+sort_parent(rpl_dag_t *dag, rpl_parent_t *p)
+{
+  rpl_parent_t *prev, *q;
+
+  if(dag->instance->of->parent_path_cost == NULL) {
+    return;
+  }
+
+  p->path_cost = dag->instance->of->parent_path_cost(p);
+  list_remove(dag->parents, p);
+
+  prev = NULL;
+  if(p->rank != INFINITE_RANK) {
+    for(q = list_head(dag->parents);
+        q != NULL && q->rank != INFINITE_RANK && q->path_cost <= p->path_cost;
+        q = q->next) {
+      prev = q;
+    }
+  } else {
+    for(q = list_head(dag->parents); q != NULL; q = q->next) {
+      prev = q;
+    }
+  }
+  list_insert(dag->parents, prev, p);
+}
+/*---------------------------------------------------------------------------*/
 /* Remove DAG parents with a rank that is at least the same as minimum_rank. */
 static void
 remove_parents(rpl_dag_t *dag, rpl_rank_t minimum_rank)
@@ -520,6 +559,7 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
   p->link_metric = RPL_INIT_LINK_METRIC;
   memcpy(&p->mc, &dio->mc, sizeof(p->mc));
   list_add(dag->parents, p);
+  sort_parent(dag, p);
   return p;
 }
 /*---------------------------------------------------------------------------*/
@@ -579,6 +619,7 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
   rpl_parent_t *last_parent;
   rpl_dag_t *dag, *end, *best_dag;
   rpl_rank_t old_rank;
+  rpl_rank_t new_rank;
 
   old_rank = instance->current_dag->rank;
   last_parent = instance->current_dag->preferred_parent;
@@ -628,14 +669,25 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
   }
 
   instance->of->update_metric_container(instance);
-  /* Update the DAG rank. */
-  best_dag->rank = instance->of->calculate_rank(best_dag->preferred_parent, 0);
+  /* Update the DAG rank if the preferred parent changed or the rank
+     moved by at least the threshold. The rank must stay at least
+     MinHopRankIncrease above the rank of the preferred parent. */
+  new_rank = instance->of->calculate_rank(best_dag->preferred_parent, 0);
+  if(RPL_RANK_THRESHOLD == 0 ||
+     best_dag->preferred_parent == NULL ||
+     best_dag->preferred_parent != last_parent ||
+     best_dag->rank < best_dag->preferred_parent->rank + instance->min_hoprankinc ||
+     new_rank >= best_dag->rank + RPL_RANK_THRESHOLD ||
+     new_rank + RPL_RANK_THRESHOLD <= best_dag->rank) {
+    best_dag->rank = new_rank;
+  }
   if(best_dag->rank < best_dag->min_rank) {
     best_dag->min_rank = best_dag->rank;
   } else if(!acceptable_rank(best_dag, best_dag->rank)) {
     PRINTF("RPL: New rank unacceptable!\n");
     instance->current_dag->preferred_parent = NULL;
-    if(instance->mop != RPL_MOP_NO_DOWNWARD_ROUTES && last_parent != NULL) {
+    if(instance->mop != RPL_MOP_NO_DOWNWARD_ROUTES &&
+       instance->mop != RPL_MOP_NON_STORING && last_parent != NULL) {
       /* Send a No-Path DAO to the removed preferred parent. */
       dao_output(last_parent, RPL_ZERO_LIFETIME);
     }
@@ -648,8 +700,10 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
   	(unsigned)old_rank, best_dag->rank);
     RPL_STAT(rpl_stats.parent_switch++);
     if(instance->mop != RPL_MOP_NO_DOWNWARD_ROUTES) {
-      if(last_parent != NULL) {
-        /* Send a No-Path DAO to the removed preferred parent. */
+      if(last_parent != NULL && instance->mop != RPL_MOP_NON_STORING) {
+        /* Send a No-Path DAO to the removed preferred parent. In
+           non-storing mode, the new DAO replaces the old parent at
+           the root. */
         dao_output(last_parent, RPL_ZERO_LIFETIME);
       }
       /* The DAO parent set changed - schedule a DAO transmission. */
@@ -670,13 +724,29 @@ rpl_select_parent(rpl_dag_t *dag)
   rpl_parent_t *p, *best;
 
   best = NULL;
-  for(p = list_head(dag->parents); p != NULL; p = p->next) {
-    if(p->rank == INFINITE_RANK) {
-      /* ignore this neighbor */
-    } else if(best == NULL) {
-      best = p;
-    } else {
-      best = dag->instance->of->best_parent(best, p);
+  if(dag->instance->of->parent_path_cost != NULL) {
+    /* The parent with the lowest path cost is first, and only has to
+       be compared with the preferred parent. A parent whose rank has
+       been set to infinite is only moved to the end of the list the
+       next time the ranks are recalculated, so such parents are
+       skipped. */
+    for(best = list_head(dag->parents);
+        best != NULL && best->rank == INFINITE_RANK;
+        best = best->next);
+    if(best != NULL && dag->preferred_parent != NULL &&
+              dag->preferred_parent != best &&
+              dag->preferred_parent->rank != INFINITE_RANK) {
+      best = dag->instance->of->best_parent(dag->preferred_parent, best);
+    }
+  } else {
+    for(p = list_head(dag->parents); p != NULL; p = p->next) {
+      if(p->rank == INFINITE_RANK) {
+        /* ignore this neighbor */
+      } else if(best == NULL) {
+        best = p;
+      } else {
+        best = dag->instance->of->best_parent(best, p);
+      }
     }
   }
 
@@ -749,6 +819,7 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   list_remove(dag_src->parents, parent);
   parent->dag = dag_dst;
   list_add(dag_dst->parents, parent);
+  sort_parent(dag_dst, parent);
 }
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
@@ -1019,7 +1090,8 @@ void
 rpl_recalculate_ranks(void)
 {
   rpl_instance_t *instance, *end;
-  rpl_parent_t *p;
+  rpl_dag_t *dag;
+  rpl_parent_t *p, *last, *preferred;
   int i;
 
   /*
@@ -1030,21 +1102,38 @@ rpl_recalculate_ranks(void)
   for(instance = &instance_table[0], end = instance + RPL_MAX_INSTANCES; instance < end; ++instance) {
     if(instance->used) {
       for(i = 0; i < RPL_MAX_DAG_PER_INSTANCE; i++) {
-        if(instance->dag_table[i].used) {
-          for(p = list_head(instance->dag_table[i].parents); p != NULL; p = p->next) {
+        dag = &instance->dag_table[i];
+        if(dag->used) {
+          /*
+           * Put all updated parents in their place first, so that the
+           * preferred parent is selected once for all of them. An update
+           * of the preferred parent is processed in preference to the
+           * others.
+           */
+          last = preferred = NULL;
+          for(p = list_head(dag->parents); p != NULL;) {
             if(p->updated) {
               p->updated = 0;
-              if(!rpl_process_parent_event(instance, p)) {
-                PRINTF("RPL: A parent was dropped\n");
+              sort_parent(dag, p);
+              if(p == dag->preferred_parent) {
+                preferred = p;
+              } else if(!acceptable_rank(dag, p->rank)) {
+                rpl_nullify_parent(dag, p);
+              } else {
+                last = p;
               }
-	      /*
-	       * Stop calculating here because the parent list may have changed.
-	       * If more ranks need to be recalculated, it will be taken care of
-	       * in subsequent calls to this functions.
-	       */
-              break;
+              /* The list may have been reordered. */
+              p = list_head(dag->parents);
+            } else {
+              p = p->next;
             }
           }
+          if(preferred != NULL) {
+            last = preferred;
+          }
+          if(last != NULL && !rpl_process_parent_event(instance, last)) {
+            PRINTF("RPL: A parent was dropped\n");
+          }
         }
       }
     }
@@ -1060,6 +1149,8 @@ rpl_process_parent_event(rpl_instance_t *instance, rpl_parent_t *p)
   old_rank = instance->current_dag->rank;
   return_value = 1;
 
+  sort_parent(p->dag, p);
+
   if(!acceptable_rank(p->dag, p->rank)) {
     /* The candidate parent is no longer valid: the rank increase resulting
        from the choice of it as a parent would be too high. */
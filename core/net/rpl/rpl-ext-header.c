@@ -61,6 +61,10 @@
 #define UIP_EXT_HDR_OPT_BUF       ((struct uip_ext_hdr_opt *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_PADN_BUF  ((struct uip_ext_hdr_opt_padn *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_RPL_BUF   ((struct uip_ext_hdr_opt_rpl *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
+#define UIP_SRH_BUF               ((struct rpl_srh_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+
+/* The longest source route the root puts in a packet. */
+#define SRH_MAX_PATH              32
 /*---------------------------------------------------------------------------*/
 #if UIP_CONF_IPV6
 int
@@ -314,4 +318,204 @@ rpl_invert_header(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_NON_STORING
+static uint8_t
+common_prefix(const uip_ipaddr_t *a, const uip_ipaddr_t *b)
+{
+  uint8_t n;
+
+  /* At most 15 octets can be elided in a source routing header. */
+  for(n = 0; n < 15 && a->u8[n] == b->u8[n]; n++);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_link_local(uip_ipaddr_t *ll, const uip_ipaddr_t *addr)
+{
+  uip_create_linklocal_prefix(ll);
+  memcpy(&ll->u8[8], &addr->u8[8], 8);
+}
+/*---------------------------------------------------------------------------*/
+/* Insert a source routing header for the path from the root, as
+   given by rpl_ns_get_path(), and send the packet to the first hop.
+   The addresses in the header are compressed by eliding the octets
+   they share with the first hop. */
+static int
+insert_srh(const uip_ipaddr_t **path, int hops)
+{
+  struct rpl_srh_hdr *srh;
+  const uip_ipaddr_t *first;
+  uint8_t cmpri, cmpre, pad;
+  uint8_t *addr;
+  int len;
+  int i;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO) {
+    /* The RPL option is not used along a source route. */
+    rpl_remove_header();
+  }
+  uip_ext_len = 0;
+
+  first = path[hops - 1];
+  cmpri = 15;
+  for(i = 1; i < hops - 1; i++) {
+    if(common_prefix(path[i], first) < cmpri) {
+      cmpri = common_prefix(path[i], first);
+    }
+  }
+  cmpre = common_prefix(path[0], first);
+  if(hops > 2 && cmpre > cmpri) {
+    /* The last address is expanded by the node before it, which
+       shares only cmpri octets with the first hop. */
+    cmpre = cmpri;
+  }
+
+  len = RPL_SRH_LEN + (hops - 2) * (16 - cmpri) + (16 - cmpre);
+  pad = (8 - len % 8) % 8;
+  len += pad;
+  if(uip_len + len > UIP_BUFSIZE) {
+    PRINTF("RPL: Packet too long: impossible to add source routing header\n");
+    return 0;
+  }
+
+  memmove(&uip_buf[UIP_LLIPH_LEN + len], &uip_buf[UIP_LLIPH_LEN],
+          uip_len - UIP_IPH_LEN);
+  srh = UIP_SRH_BUF;
+  srh->next = UIP_IP_BUF->proto;
+  srh->len = len / 8 - 1;
+  srh->routing_type = RPL_RH_TYPE_SRH;
+  srh->seg_left = hops - 1;
+  srh->cmpr = (cmpri << 4) | cmpre;
+  srh->pad = pad << 4;
+  srh->reserved[0] = 0;
+  srh->reserved[1] = 0;
+
+  addr = (uint8_t *)srh + RPL_SRH_LEN;
+  for(i = hops - 2; i > 0; i--) {
+    memcpy(addr, &path[i]->u8[cmpri], 16 - cmpri);
+    addr += 16 - cmpri;
+  }
+  memcpy(addr, &path[0]->u8[cmpre], 16 - cmpre);
+  memset(addr + 16 - cmpre, 0, pad);
+
+  PRINTF("RPL: Inserted a source routing header with %d hops to ", hops);
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("\n");
+
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, first);
+  uip_len += len;
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the next hop of a packet that follows a source route, or that
+   the root of a non-storing mode DAG sends down. Returns 0 if the
+   packet is routed normally. If the source route could not be added,
+   uip_len is set to 0. */
+int
+rpl_srh_next_hop(uip_ipaddr_t *nexthop)
+{
+  rpl_dag_t *dag;
+  const uip_ipaddr_t *path[SRH_MAX_PATH];
+  int last_uip_ext_len;
+  uint8_t proto;
+  int hops;
+
+  last_uip_ext_len = uip_ext_len;
+  uip_ext_len = 0;
+  proto = UIP_IP_BUF->proto;
+  if(proto == UIP_PROTO_HBHO) {
+    proto = UIP_HBHO_BUF->next;
+    uip_ext_len = (UIP_HBHO_BUF->len << 3) + 8;
+  }
+  if(proto == UIP_PROTO_ROUTING &&
+     UIP_SRH_BUF->routing_type == RPL_RH_TYPE_SRH) {
+    /* The destination is the next node on the source route, which is
+       a neighbor. */
+    uip_ext_len = last_uip_ext_len;
+    set_link_local(nexthop, &UIP_IP_BUF->destipaddr);
+    return 1;
+  }
+  uip_ext_len = last_uip_ext_len;
+
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->instance->mop != RPL_MOP_NON_STORING ||
+     dag->rank != ROOT_RANK(dag->instance)) {
+    return 0;
+  }
+
+  hops = rpl_ns_get_path(&UIP_IP_BUF->destipaddr, path, SRH_MAX_PATH);
+  if(hops == 0) {
+    PRINTF("RPL: No source route to ");
+    PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+    PRINTF("\n");
+    return 0;
+  }
+
+  if(hops > 1 && !insert_srh(path, hops)) {
+    uip_len = 0;
+    return 1;
+  }
+  set_link_local(nexthop, &UIP_IP_BUF->destipaddr);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Process a source routing header with segments left (RFC 6554,
+   section 4.2): swap the destination address with the next address
+   in the header. Returns 1 if the packet should be forwarded to the
+   new destination. */
+int
+rpl_process_srh_header(void)
+{
+  struct rpl_srh_hdr *srh;
+  uip_ipaddr_t addr;
+  uint8_t cmpri, cmpre, cmpr;
+  uint8_t *next;
+  int size;
+  int n;
+  int i;
+
+  srh = UIP_SRH_BUF;
+  if(srh->routing_type != RPL_RH_TYPE_SRH || srh->seg_left == 0 ||
+     uip_l3_hdr_len + (srh->len + 1) * 8 > uip_len) {
+    return 0;
+  }
+
+  cmpri = RPL_SRH_CMPRI(srh);
+  cmpre = RPL_SRH_CMPRE(srh);
+  size = (srh->len + 1) * 8 - RPL_SRH_LEN - RPL_SRH_PAD(srh);
+  if(size < 16 - cmpre) {
+    PRINTF("RPL: Bad source routing header\n");
+    return 0;
+  }
+  n = (size - (16 - cmpre)) / (16 - cmpri) + 1;
+  if(srh->seg_left > n) {
+    PRINTF("RPL: Bad source routing header\n");
+    return 0;
+  }
+
+  srh->seg_left--;
+  i = n - srh->seg_left;
+  cmpr = i == n ? cmpre : cmpri;
+  next = (uint8_t *)srh + RPL_SRH_LEN + (i - 1) * (16 - cmpri);
+
+  uip_ipaddr_copy(&addr, &UIP_IP_BUF->destipaddr);
+  memcpy(&UIP_IP_BUF->destipaddr.u8[cmpr], next, 16 - cmpr);
+  memcpy(next, &addr.u8[cmpr], 16 - cmpr);
+
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr)) {
+    PRINTF("RPL: Loop in source routing header\n");
+    return 0;
+  }
+
+  PRINTF("RPL: Forwarding along source route to ");
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("\n");
+  return 1;
+}
+#endif /* RPL_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
 #endif /* UIP_CONF_IPV6 */
@@ -67,6 +67,10 @@
 #define UIP_IP_BUF       ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_ICMP_BUF     ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
 #define UIP_ICMP_PAYLOAD ((unsigned char *)&uip_buf[uip_l2_l3_icmp_hdr_len])
+
+#define RPL_DAO_TRANSIT_LEN              6
+#define RPL_DAO_MAX_LEN                  (UIP_BUFSIZE - UIP_LLH_LEN - \
+                                          UIP_IPICMPH_LEN - RPL_HOP_BY_HOP_LEN)
 /*---------------------------------------------------------------------------*/
 static void dis_input(void);
 static void dio_input(void);
@@ -84,6 +88,20 @@ void RPL_DEBUG_DAO_OUTPUT(rpl_parent_t *);
 
 static uint8_t dao_sequence = RPL_LOLLIPOP_INIT;
 
+#if RPL_DAO_AGGREGATION_DELAY
+/* The targets of the DAOs of the children that are waiting to be sent
+   to the preferred parent. */
+struct dao_target {
+  uip_ipaddr_t prefix;
+  rpl_instance_t *instance;
+  uint8_t length;
+  uint8_t lifetime;
+};
+static struct dao_target dao_targets[RPL_DAO_MAX_TARGETS];
+static uint8_t dao_target_count;
+static struct ctimer dao_aggregation_timer;
+#endif /* RPL_DAO_AGGREGATION_DELAY */
+
 /* some debug callbacks useful when debugging RPL networks */
 #ifdef RPL_DEBUG_DIO_INPUT
 void RPL_DEBUG_DIO_INPUT(uip_ipaddr_t *, rpl_dio_t *);
@@ -553,6 +571,338 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+static int
+add_dao_header(unsigned char *buffer, rpl_instance_t *instance)
+{
+  int pos;
+
+  RPL_LOLLIPOP_INCREMENT(dao_sequence);
+  pos = 0;
+
+  buffer[pos++] = instance->instance_id;
+  buffer[pos] = 0;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+#if RPL_CONF_DAO_ACK
+  buffer[pos] |= RPL_DAO_K_FLAG;
+#endif /* RPL_CONF_DAO_ACK */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = dao_sequence;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &instance->current_dag->dag_id,
+         sizeof(instance->current_dag->dag_id));
+  pos += sizeof(instance->current_dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+add_target(unsigned char *buffer, int pos, uip_ipaddr_t *prefix,
+           uint8_t prefixlen)
+{
+  buffer[pos++] = RPL_OPTION_TARGET;
+  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = prefixlen;
+  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
+  pos += ((prefixlen + 7) / CHAR_BIT);
+  RPL_STAT(rpl_stats.dao_targets_sent++);
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+add_transit(unsigned char *buffer, int pos, uint8_t lifetime)
+{
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = 4;
+  buffer[pos++] = 0; /* flags - ignored */
+  buffer[pos++] = 0; /* path control - ignored */
+  buffer[pos++] = 0; /* path seq - ignored */
+  buffer[pos++] = lifetime;
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_DAO_AGGREGATION_DELAY
+/* Add the waiting targets of an instance that fit in the DAO, with a
+   transit option after each run of targets with the same lifetime. */
+static int
+add_queued_targets(unsigned char *buffer, int pos, rpl_instance_t *instance)
+{
+  struct dao_target *t;
+  int i;
+  int len;
+  int lifetime;
+
+  lifetime = -1;
+  for(i = 0; i < dao_target_count;) {
+    t = &dao_targets[i];
+    if(t->instance != instance) {
+      i++;
+      continue;
+    }
+
+    len = 4 + (t->length + 7) / CHAR_BIT + RPL_DAO_TRANSIT_LEN;
+    if(lifetime >= 0 && t->lifetime != lifetime) {
+      len += RPL_DAO_TRANSIT_LEN;
+    }
+    if(lifetime >= 0 && pos + len > RPL_DAO_MAX_LEN) {
+      /* The rest is sent in the next DAO. */
+      break;
+    }
+
+    if(lifetime >= 0 && t->lifetime != lifetime) {
+      pos = add_transit(buffer, pos, lifetime);
+    }
+    lifetime = t->lifetime;
+    pos = add_target(buffer, pos, &t->prefix, t->length);
+
+    /* Remove the target by moving the last one into its place. */
+    *t = dao_targets[--dao_target_count];
+  }
+  if(lifetime >= 0) {
+    pos = add_transit(buffer, pos, lifetime);
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+has_queued_targets(rpl_instance_t *instance)
+{
+  int i;
+
+  for(i = 0; i < dao_target_count; i++) {
+    if(dao_targets[i].instance == instance) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+drop_queued_targets(rpl_instance_t *instance)
+{
+  int i;
+
+  for(i = 0; i < dao_target_count;) {
+    if(dao_targets[i].instance == instance) {
+      dao_targets[i] = dao_targets[--dao_target_count];
+    } else {
+      i++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_dao_aggregation_timer(void *ptr)
+{
+  rpl_instance_t *instance;
+  rpl_parent_t *parent;
+  unsigned char *buffer;
+  int pos;
+
+  while(dao_target_count > 0) {
+    instance = dao_targets[0].instance;
+    parent = NULL;
+    if(instance->used && instance->current_dag != NULL) {
+      parent = instance->current_dag->preferred_parent;
+    }
+    if(parent == NULL) {
+      PRINTF("RPL: No parent to forward the DAO targets to\n");
+      drop_queued_targets(instance);
+      continue;
+    }
+
+    buffer = UIP_ICMP_PAYLOAD;
+    pos = add_dao_header(buffer, instance);
+    pos = add_queued_targets(buffer, pos, instance);
+
+    PRINTF("RPL: Forwarding aggregated DAO to parent ");
+    PRINT6ADDR(&parent->addr);
+    PRINTF("\n");
+
+    RPL_STAT(rpl_stats.dao_sent++);
+    uip_icmp6_send(&parent->addr, ICMP6_RPL, RPL_CODE_DAO, pos);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Keep a target to send it with the next DAO to the preferred parent.
+   Returns 0 if there is no room for it. */
+static int
+queue_dao_target(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+                 uint8_t length, uint8_t lifetime)
+{
+  struct dao_target *t;
+  int i;
+
+  for(i = 0; i < dao_target_count; i++) {
+    t = &dao_targets[i];
+    if(t->instance == instance && t->length == length &&
+       uip_ipaddr_cmp(&t->prefix, prefix)) {
+      t->lifetime = lifetime;
+      return 1;
+    }
+  }
+
+  if(dao_target_count == RPL_DAO_MAX_TARGETS) {
+    return 0;
+  }
+
+  t = &dao_targets[dao_target_count++];
+  t->instance = instance;
+  uip_ipaddr_copy(&t->prefix, prefix);
+  t->length = length;
+  t->lifetime = lifetime;
+
+  if(ctimer_expired(&dao_aggregation_timer)) {
+    ctimer_set(&dao_aggregation_timer, RPL_DAO_AGGREGATION_DELAY,
+               handle_dao_aggregation_timer, NULL);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+count_dao_targets(unsigned char *buffer, int from, int to)
+{
+  int count;
+  int len;
+  int i;
+
+  count = 0;
+  for(i = from; i < to; i += len) {
+    if(buffer[i] == RPL_OPTION_PAD1) {
+      len = 1;
+      continue;
+    }
+    len = 2 + buffer[i + 1];
+    if(buffer[i] == RPL_OPTION_TARGET) {
+      count++;
+    }
+  }
+  return count;
+}
+#endif /* RPL_DAO_AGGREGATION_DELAY */
+/*---------------------------------------------------------------------------*/
+/* Process the targets in buffer[from..to), which share the transit
+   information that follows them. If aggregate is set, the targets are
+   queued to be sent with the next DAO to the preferred parent.
+   Returns the number of targets that should be forwarded in the DAO
+   as it was received. */
+static int
+dao_targets_input(rpl_instance_t *instance, unsigned char *buffer,
+                  int from, int to, uint8_t lifetime,
+                  uip_ipaddr_t *parent_addr, uip_ipaddr_t *dao_sender_addr,
+                  int learned_from, int aggregate)
+{
+  rpl_dag_t *dag;
+  uip_ds6_route_t *rep;
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  int forward;
+  int len;
+  int i;
+
+  dag = instance->current_dag;
+  forward = 0;
+
+  for(i = from; i < to; i += len) {
+    if(buffer[i] == RPL_OPTION_PAD1) {
+      len = 1;
+      continue;
+    }
+    len = 2 + buffer[i + 1];
+    if(buffer[i] != RPL_OPTION_TARGET) {
+      continue;
+    }
+
+    prefixlen = buffer[i + 3];
+    memset(&prefix, 0, sizeof(prefix));
+    memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+
+    PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+           (unsigned)lifetime, (unsigned)prefixlen);
+    PRINT6ADDR(&prefix);
+    PRINTF("\n");
+
+#if RPL_WITH_NON_STORING
+    if(instance->mop == RPL_MOP_NON_STORING) {
+      /* The DAOs of a non-storing mode DAG are sent to the root, which
+         records the parent of the target in its graph. */
+      if(dag->rank != ROOT_RANK(instance) || parent_addr == NULL) {
+        PRINTF("RPL: Ignoring a non-storing mode DAO\n");
+      } else if(!rpl_ns_update_node(&prefix, parent_addr,
+                                    RPL_LIFETIME(instance, lifetime))) {
+        PRINTF("RPL: Could not add a node after receiving a DAO\n");
+      }
+      continue;
+    }
+#endif /* RPL_WITH_NON_STORING */
+
+    rep = uip_ds6_route_lookup(&prefix);
+
+    if(lifetime == RPL_ZERO_LIFETIME) {
+      /* No-Path DAO received; invoke the route purging routine. */
+      if(rep != NULL && rep->state.saved_lifetime == 0 && rep->length == prefixlen) {
+        PRINTF("RPL: Setting expiration timer for prefix ");
+        PRINT6ADDR(&prefix);
+        PRINTF("\n");
+        rep->state.saved_lifetime = rep->state.lifetime;
+        rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
+      }
+      continue;
+    }
+
+    rep = rpl_add_route(dag, &prefix, prefixlen, dao_sender_addr);
+    if(rep == NULL) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a route after receiving a DAO\n");
+      continue;
+    }
+
+    rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+    rep->state.learned_from = learned_from;
+
+    if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+#if RPL_DAO_AGGREGATION_DELAY
+      if(!aggregate || !queue_dao_target(instance, &prefix, prefixlen, lifetime)) {
+        forward++;
+      }
+#else /* RPL_DAO_AGGREGATION_DELAY */
+      forward++;
+#endif /* RPL_DAO_AGGREGATION_DELAY */
+    }
+  }
+  return forward;
+}
+/*---------------------------------------------------------------------------*/
+/* In storing mode, a unicast DAO comes from a node below us. If the
+   sender is one of our parents with a lower rank than ours, a loop
+   has formed, and the parent is no longer used. */
+static int
+dao_loop_detected(rpl_instance_t *instance, uip_ipaddr_t *sender,
+                  int learned_from)
+{
+  rpl_dag_t *dag;
+  rpl_parent_t *p;
+
+  if(learned_from != RPL_ROUTE_FROM_UNICAST_DAO ||
+     instance->mop == RPL_MOP_NON_STORING) {
+    return 0;
+  }
+
+  dag = instance->current_dag;
+  p = rpl_find_parent(dag, sender);
+  if(p != NULL && DAG_RANK(p->rank, instance) < DAG_RANK(dag->rank, instance)) {
+    PRINTF("RPL: Loop detected when receiving a unicast DAO from a node with a lower rank! (%u < %u)\n",
+        DAG_RANK(p->rank, instance), DAG_RANK(dag->rank, instance));
+    p->rank = INFINITE_RANK;
+    p->updated = 1;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 dao_input(void)
 {
@@ -563,21 +913,19 @@ dao_input(void)
   uint16_t sequence;
   uint8_t instance_id;
   uint8_t lifetime;
-  uint8_t prefixlen;
   uint8_t flags;
   uint8_t subopt_type;
-  uint8_t pathcontrol;
-  uint8_t pathsequence;
-  uip_ipaddr_t prefix;
-  uip_ds6_route_t *rep;
+  uip_ipaddr_t parent_addr;
+  uip_ipaddr_t *parent;
   uint8_t buffer_length;
   int pos;
   int len;
   int i;
+  int targets;
+  int target_count;
+  int forward;
   int learned_from;
-  rpl_parent_t *p;
-
-  prefixlen = 0;
+  int aggregate;
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
 
@@ -599,7 +947,7 @@ dao_input(void)
     return;
   }
 
-  lifetime = instance->default_lifetime;
+  RPL_STAT(rpl_stats.dao_received++);
 
   flags = buffer[pos++];
   /* reserved */
@@ -618,9 +966,29 @@ dao_input(void)
     /* Perhaps, there are verification to do but ... */
   }
 
-  /* Check if there are any RPL options present. */
-  i = pos;
-  for(; i < buffer_length; i += len) {
+  learned_from = uip_is_addr_mcast(&dao_sender_addr) ?
+                 RPL_ROUTE_FROM_MULTICAST_DAO : RPL_ROUTE_FROM_UNICAST_DAO;
+
+  aggregate = 0;
+#if RPL_DAO_AGGREGATION_DELAY
+  /* The targets are only aggregated if there is room for all of them
+     in the queue. Otherwise the DAO is forwarded as it was received,
+     and none of its targets is queued to be sent a second time. */
+  aggregate = learned_from == RPL_ROUTE_FROM_UNICAST_DAO &&
+    count_dao_targets(buffer, pos, buffer_length) <=
+    RPL_DAO_MAX_TARGETS - dao_target_count;
+#endif /* RPL_DAO_AGGREGATION_DELAY */
+
+  /*
+   * The DAO may carry several groups of target options, each followed
+   * by the transit information options that apply to the group. No-Path
+   * groups are handled before the loop check, as they only remove
+   * routes.
+   */
+  forward = 0;
+  target_count = 0;
+  targets = -1;
+  for(i = pos; i < buffer_length; i += len) {
     subopt_type = buffer[i];
     if(subopt_type == RPL_OPTION_PAD1) {
       len = 1;
@@ -631,72 +999,65 @@ dao_input(void)
 
     switch(subopt_type) {
     case RPL_OPTION_TARGET:
-      /* Handle the target option. */
-      prefixlen = buffer[i + 3];
-      memset(&prefix, 0, sizeof(prefix));
-      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+      RPL_STAT(rpl_stats.dao_targets_received++);
+      if(targets < 0) {
+        targets = i;
+      }
+      target_count++;
       break;
     case RPL_OPTION_TRANSIT:
+      if(targets < 0) {
+        /* Only the first transit option of a group is used. */
+        break;
+      }
       /* The path sequence and control are ignored. */
-      pathcontrol = buffer[i + 3];
-      pathsequence = buffer[i + 4];
       lifetime = buffer[i + 5];
-      /* The parent address is also ignored. */
+      parent = NULL;
+      /* The parent address is only used in non-storing mode. */
+      if(buffer[i + 1] >= 4 + sizeof(parent_addr)) {
+        memcpy(&parent_addr, buffer + i + 6, sizeof(parent_addr));
+        parent = &parent_addr;
+      }
+      if(lifetime != RPL_ZERO_LIFETIME &&
+         dao_loop_detected(instance, &dao_sender_addr, learned_from)) {
+        return;
+      }
+      forward += dao_targets_input(instance, buffer, targets, i, lifetime,
+                                   parent, &dao_sender_addr, learned_from,
+                                   aggregate);
+      targets = -1;
       break;
     }
   }
-
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-          (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF("\n");
-
-  rep = uip_ds6_route_lookup(&prefix);
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL && rep->state.saved_lifetime == 0 && rep->length == prefixlen) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
-      PRINT6ADDR(&prefix);
-      PRINTF("\n");
-      rep->state.saved_lifetime = rep->state.lifetime;
-      rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
-    }
-    return;
-  }
-
-  learned_from = uip_is_addr_mcast(&dao_sender_addr) ?
-                 RPL_ROUTE_FROM_MULTICAST_DAO : RPL_ROUTE_FROM_UNICAST_DAO;
-
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
-    /* Check whether this is a DAO forwarding loop. */
-    p = rpl_find_parent(dag, &dao_sender_addr);
-    /* check if this is a new DAO registration with an "illegal" rank */
-    /* if we already route to this node it is likely */
-    if(p != NULL && DAG_RANK(p->rank, instance) < DAG_RANK(dag->rank, instance)) {
-      PRINTF("RPL: Loop detected when receiving a unicast DAO from a node with a lower rank! (%u < %u)\n",
-          DAG_RANK(p->rank, instance), DAG_RANK(dag->rank, instance));
-      p->rank = INFINITE_RANK;
-      p->updated = 1;
+  if(targets >= 0) {
+    /* Targets without transit information get the default lifetime. */
+    if(instance->default_lifetime != RPL_ZERO_LIFETIME &&
+       dao_loop_detected(instance, &dao_sender_addr, learned_from)) {
       return;
     }
+    forward += dao_targets_input(instance, buffer, targets, buffer_length,
+                                 instance->default_lifetime, NULL,
+                                 &dao_sender_addr, learned_from, aggregate);
   }
 
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
+#if RPL_WITH_NON_STORING
+  if(instance->mop == RPL_MOP_NON_STORING) {
+    if(dag->rank == ROOT_RANK(instance) && (flags & RPL_DAO_K_FLAG)) {
+      dao_ack_output(instance, &dao_sender_addr, sequence);
+    }
     return;
   }
-
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  rep->state.learned_from = learned_from;
+#endif /* RPL_WITH_NON_STORING */
 
   if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
-    if(dag->preferred_parent) {
+    if(forward > 0 && dag->preferred_parent) {
+      /* Targets that are not aggregated are forwarded in the DAO as
+         it was received. */
       PRINTF("RPL: Forwarding DAO to parent ");
       PRINT6ADDR(&dag->preferred_parent->addr);
       PRINTF("\n");
+      RPL_STAT(rpl_stats.dao_sent++);
+      RPL_STAT(rpl_stats.dao_targets_sent += target_count);
       uip_icmp6_send(&dag->preferred_parent->addr,
                      ICMP6_RPL, RPL_CODE_DAO, buffer_length);
     }
@@ -712,7 +1073,6 @@ dao_output(rpl_parent_t *n, uint8_t lifetime)
   rpl_dag_t *dag;
   rpl_instance_t *instance;
   unsigned char *buffer;
-  uint8_t prefixlen;
   uip_ipaddr_t prefix;
   int pos;
 
@@ -732,41 +1092,50 @@ dao_output(rpl_parent_t *n, uint8_t lifetime)
 
   buffer = UIP_ICMP_PAYLOAD;
 
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
-  pos = 0;
-
-  buffer[pos++] = instance->instance_id;
-  buffer[pos] = 0;
-#if RPL_DAO_SPECIFY_DAG
-  buffer[pos] |= RPL_DAO_D_FLAG;
-#endif /* RPL_DAO_SPECIFY_DAG */
-#if RPL_CONF_DAO_ACK
-  buffer[pos] |= RPL_DAO_K_FLAG;
-#endif /* RPL_CONF_DAO_ACK */
-  ++pos;
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = dao_sequence;
-#if RPL_DAO_SPECIFY_DAG
-  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
-  pos+=sizeof(dag->dag_id);
-#endif /* RPL_DAO_SPECIFY_DAG */
+  pos = add_dao_header(buffer, instance);
 
   /* create target subopt */
-  prefixlen = sizeof(prefix) * CHAR_BIT;
-  buffer[pos++] = RPL_OPTION_TARGET;
-  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = prefixlen;
-  memcpy(buffer + pos, &prefix, (prefixlen + 7) / CHAR_BIT);
-  pos += ((prefixlen + 7) / CHAR_BIT);
+  pos = add_target(buffer, pos, &prefix, sizeof(prefix) * CHAR_BIT);
+
+#if RPL_WITH_NON_STORING
+  if(instance->mop == RPL_MOP_NON_STORING) {
+    /* Create a transit information sub-option. The DAO goes to the
+       root, with the global address of the parent, made from our
+       prefix and the interface identifier of the parent. */
+    buffer[pos++] = RPL_OPTION_TRANSIT;
+    buffer[pos++] = 4 + sizeof(uip_ipaddr_t);
+    buffer[pos++] = 0; /* flags - ignored */
+    buffer[pos++] = 0; /* path control - ignored */
+    buffer[pos++] = 0; /* path seq - ignored */
+    buffer[pos++] = lifetime;
+    memcpy(buffer + pos, &prefix, 8);
+    memcpy(buffer + pos + 8, &n->addr.u8[8], 8);
+    pos += sizeof(uip_ipaddr_t);
+
+    PRINTF("RPL: Sending DAO with prefix ");
+    PRINT6ADDR(&prefix);
+    PRINTF(" to ");
+    PRINT6ADDR(&dag->dag_id);
+    PRINTF("\n");
+
+    RPL_STAT(rpl_stats.dao_sent++);
+    uip_icmp6_send(&dag->dag_id, ICMP6_RPL, RPL_CODE_DAO, pos);
+    return;
+  }
+#endif /* RPL_WITH_NON_STORING */
 
   /* Create a transit information sub-option. */
-  buffer[pos++] = RPL_OPTION_TRANSIT;
-  buffer[pos++] = 4;
-  buffer[pos++] = 0; /* flags - ignored */
-  buffer[pos++] = 0; /* path control - ignored */
-  buffer[pos++] = 0; /* path seq - ignored */
-  buffer[pos++] = lifetime;
+  pos = add_transit(buffer, pos, lifetime);
+
+#if RPL_DAO_AGGREGATION_DELAY
+  if(n == instance->current_dag->preferred_parent) {
+    /* The targets of the children go along with our own. */
+    pos = add_queued_targets(buffer, pos, instance);
+    if(!has_queued_targets(instance)) {
+      ctimer_stop(&dao_aggregation_timer);
+    }
+  }
+#endif /* RPL_DAO_AGGREGATION_DELAY */
 
   PRINTF("RPL: Sending DAO with prefix ");
   PRINT6ADDR(&prefix);
@@ -774,6 +1143,7 @@ dao_output(rpl_parent_t *n, uint8_t lifetime)
   PRINT6ADDR(&n->addr);
   PRINTF("\n");
 
+  RPL_STAT(rpl_stats.dao_sent++);
   uip_icmp6_send(&n->addr, ICMP6_RPL, RPL_CODE_DAO, pos);
 }
 /*---------------------------------------------------------------------------*/
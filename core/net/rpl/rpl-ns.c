@@ -0,0 +1,277 @@
+/**
+ * \addtogroup uip6
+ * @{
+ */
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+/**
+ * \file
+ *         The graph of the nodes in a non-storing mode DAG, kept by
+ *         the DAG root. Every node is stored with the parent it
+ *         announced in its DAO, from which the root builds the
+ *         source routes to the node.
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "sys/clock.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#include <string.h>
+
+#if UIP_CONF_IPV6 && RPL_WITH_NON_STORING
+
+/* The nodes refer to each other by their index in the node table, so
+   that a graph of thousands of nodes stays small. */
+#define NODE_NONE       0xffff
+#define NODE_ROOT       0xfffe
+
+#define HASH_SIZE       RPL_NS_LINK_NUM
+
+struct ns_node {
+  uip_ipaddr_t addr;
+  /* The time, in clock_seconds(), when the DAO of the node expires. 0
+     if the node has not sent one and is only known as a parent. */
+  unsigned long expires;
+  uint16_t parent;
+  uint16_t hash_next;
+  uint16_t children;
+  uint8_t used;
+};
+
+static struct ns_node nodes[RPL_NS_LINK_NUM];
+static uint16_t hash_table[HASH_SIZE];
+static uint16_t free_list;
+static uint16_t num_nodes;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+hash(const uip_ipaddr_t *addr)
+{
+  uint32_t h;
+  int i;
+
+  /* The nodes of a DAG usually share their prefix, so only the
+     interface identifier is hashed. */
+  h = 2166136261UL;
+  for(i = 8; i < sizeof(uip_ipaddr_t); i++) {
+    h = (h ^ addr->u8[i]) * 16777619UL;
+  }
+  return h % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+lookup(const uip_ipaddr_t *addr)
+{
+  uint16_t i;
+
+  for(i = hash_table[hash(addr)]; i != NODE_NONE; i = nodes[i].hash_next) {
+    if(uip_ipaddr_cmp(&nodes[i].addr, addr)) {
+      return i;
+    }
+  }
+  return NODE_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+alloc(const uip_ipaddr_t *addr)
+{
+  uint16_t i;
+  uint16_t h;
+
+  i = free_list;
+  if(i == NODE_NONE) {
+    PRINTF("RPL: Non-storing mode graph full\n");
+    RPL_STAT(rpl_stats.mem_overflows++);
+    return NODE_NONE;
+  }
+  free_list = nodes[i].hash_next;
+
+  uip_ipaddr_copy(&nodes[i].addr, addr);
+  nodes[i].expires = 0;
+  nodes[i].parent = NODE_NONE;
+  nodes[i].children = 0;
+  nodes[i].used = 1;
+  h = hash(addr);
+  nodes[i].hash_next = hash_table[h];
+  hash_table[h] = i;
+  num_nodes++;
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+release(uint16_t i)
+{
+  uint16_t *p;
+
+  for(p = &hash_table[hash(&nodes[i].addr)]; *p != NODE_NONE;
+      p = &nodes[*p].hash_next) {
+    if(*p == i) {
+      *p = nodes[i].hash_next;
+      break;
+    }
+  }
+  nodes[i].used = 0;
+  nodes[i].hash_next = free_list;
+  free_list = i;
+  num_nodes--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_parent(uint16_t i, uint16_t parent)
+{
+  if(nodes[i].parent < NODE_ROOT) {
+    nodes[nodes[i].parent].children--;
+  }
+  nodes[i].parent = parent;
+  if(parent < NODE_ROOT) {
+    nodes[parent].children++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_registered(uint16_t i)
+{
+  return nodes[i].parent != NODE_NONE && nodes[i].expires > clock_seconds();
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_init(void)
+{
+  uint16_t i;
+
+  for(i = 0; i < HASH_SIZE; i++) {
+    hash_table[i] = NODE_NONE;
+  }
+  for(i = 0; i < RPL_NS_LINK_NUM; i++) {
+    nodes[i].used = 0;
+    nodes[i].hash_next = i + 1 < RPL_NS_LINK_NUM ? i + 1 : NODE_NONE;
+  }
+  free_list = 0;
+  num_nodes = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Record that the parent of child is parent, for lifetime seconds. A
+   lifetime of 0 removes the link, if it is the current one. */
+int
+rpl_ns_update_node(const uip_ipaddr_t *child, const uip_ipaddr_t *parent,
+                   uint32_t lifetime)
+{
+  uint16_t c;
+  uint16_t p;
+
+  c = lookup(child);
+
+  if(uip_ds6_is_my_addr((uip_ipaddr_t *)parent)) {
+    p = NODE_ROOT;
+  } else {
+    p = lookup(parent);
+  }
+
+  if(lifetime == RPL_ZERO_LIFETIME) {
+    if(c != NODE_NONE && p != NODE_NONE && nodes[c].parent == p) {
+      set_parent(c, NODE_NONE);
+      nodes[c].expires = 0;
+    }
+    return 1;
+  }
+
+  if(p == NODE_NONE) {
+    /* The parent has not sent its own DAO yet. */
+    p = alloc(parent);
+    if(p == NODE_NONE) {
+      return 0;
+    }
+  }
+  if(c == NODE_NONE) {
+    c = alloc(child);
+    if(c == NODE_NONE) {
+      return 0;
+    }
+  }
+  if(c == p) {
+    return 0;
+  }
+
+  set_parent(c, p);
+  nodes[c].expires = clock_seconds() + lifetime;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Put the route to addr in path, starting with addr and ending with
+   the first hop from the root. Returns the number of hops, or 0 if
+   there is no route of at most max hops. */
+int
+rpl_ns_get_path(const uip_ipaddr_t *addr, const uip_ipaddr_t **path, int max)
+{
+  uint16_t i;
+  int len;
+
+  len = 0;
+  for(i = lookup(addr); i != NODE_ROOT; i = nodes[i].parent) {
+    if(i == NODE_NONE || len == max || !is_registered(i)) {
+      /* Unknown or expired node, or a loop. */
+      return 0;
+    }
+    path[len++] = &nodes[i].addr;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_num_nodes(void)
+{
+  return num_nodes;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove the links of the expired nodes, and the nodes that are
+   neither registered nor the parent of another node. */
+void
+rpl_ns_periodic(void)
+{
+  unsigned long now;
+  uint16_t i;
+
+  now = clock_seconds();
+  for(i = 0; i < RPL_NS_LINK_NUM; i++) {
+    if(nodes[i].used && nodes[i].expires <= now) {
+      set_parent(i, NODE_NONE);
+      if(nodes[i].children == 0) {
+        PRINTF("RPL: Removing expired node ");
+        PRINT6ADDR(&nodes[i].addr);
+        PRINTF(" from the graph\n");
+        release(i);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_CONF_IPV6 && RPL_WITH_NON_STORING */
@@ -51,6 +51,7 @@ static rpl_parent_t *best_parent(rpl_parent_t *, rpl_parent_t *);
 static rpl_dag_t *best_dag(rpl_dag_t *, rpl_dag_t *);
 static rpl_rank_t calculate_rank(rpl_parent_t *, rpl_rank_t);
 static void update_metric_container(rpl_instance_t *);
+static uint16_t parent_path_cost(rpl_parent_t *);
 
 rpl_of_t rpl_of0 = {
   reset,
@@ -59,7 +60,8 @@ rpl_of_t rpl_of0 = {
   best_dag,
   calculate_rank,
   update_metric_container,
-  0
+  0,
+  parent_path_cost
 };
 
 #define DEFAULT_RANK_INCREMENT  RPL_MIN_HOPRANKINC
@@ -122,6 +124,15 @@ best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
   }
 }
 
+static uint16_t
+parent_path_cost(rpl_parent_t *p)
+{
+  /* Compare parents by looking both at their rank and at the ETX for
+     them. */
+  return DAG_RANK(p->rank, p->dag->instance) * NEIGHBOR_INFO_ETX_DIVISOR +
+    p->link_metric;
+}
+
 static rpl_parent_t *
 best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
@@ -137,13 +148,9 @@ best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
         p2->link_metric, p2->rank);
 
 
-  r1 = DAG_RANK(p1->rank, p1->dag->instance) * NEIGHBOR_INFO_ETX_DIVISOR +
-         p1->link_metric;
-  r2 = DAG_RANK(p2->rank, p1->dag->instance) * NEIGHBOR_INFO_ETX_DIVISOR +
-         p2->link_metric;
-  /* Compare two parents by looking both and their rank and at the ETX
-     for that parent. We choose the parent that has the most
-     favourable combination. */
+  r1 = parent_path_cost(p1);
+  r2 = parent_path_cost(p2);
+  /* We choose the parent that has the most favourable combination. */
 
   dag = (rpl_dag_t *)p1->dag; /* Both parents must be in the same DAG. */
   if(r1 < r2 + MIN_DIFFERENCE &&
@@ -100,6 +100,23 @@
 #define RPL_HDR_OPT_FWD_ERR		0x20
 #define RPL_HDR_OPT_FWD_ERR_SHIFT   	5
 /*---------------------------------------------------------------------------*/
+/* RPL source routing header (RFC 6554). */
+#define RPL_RH_TYPE_SRH                 3
+#define RPL_SRH_LEN                     8
+#define RPL_SRH_CMPRI(srh)              ((srh)->cmpr >> 4)
+#define RPL_SRH_CMPRE(srh)              ((srh)->cmpr & 0x0f)
+#define RPL_SRH_PAD(srh)                ((srh)->pad >> 4)
+
+struct rpl_srh_hdr {
+  uint8_t next;
+  uint8_t len;
+  uint8_t routing_type;
+  uint8_t seg_left;
+  uint8_t cmpr;
+  uint8_t pad;
+  uint8_t reserved[2];
+};
+/*---------------------------------------------------------------------------*/
 /* Default values for RPL constants and variables. */
 
 /* The default value for the DAO timer. */
@@ -109,6 +126,22 @@
 #define RPL_DAO_LATENCY                 (CLOCK_SECOND * 4)
 #endif /* RPL_DAO_LATENCY */
 
+/* The time that a router in storing mode collects the targets of the
+   DAOs of its children before it sends them in one DAO to its parent.
+   0 forwards the targets of every DAO as soon as it is received. */
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY       RPL_CONF_DAO_AGGREGATION_DELAY
+#else /* RPL_CONF_DAO_AGGREGATION_DELAY */
+#define RPL_DAO_AGGREGATION_DELAY       0
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+/* The number of targets that are waiting to be forwarded. */
+#ifdef RPL_CONF_DAO_MAX_TARGETS
+#define RPL_DAO_MAX_TARGETS             RPL_CONF_DAO_MAX_TARGETS
+#else /* RPL_CONF_DAO_MAX_TARGETS */
+#define RPL_DAO_MAX_TARGETS             8
+#endif /* RPL_CONF_DAO_MAX_TARGETS */
+
 /* Special value indicating immediate removal. */
 #define RPL_ZERO_LIFETIME               0
 
@@ -177,6 +210,8 @@
 
 #ifdef  RPL_CONF_MOP
 #define RPL_MOP_DEFAULT                 RPL_CONF_MOP
+#elif RPL_WITH_NON_STORING
+#define RPL_MOP_DEFAULT                 RPL_MOP_NON_STORING
 #else
 #define RPL_MOP_DEFAULT                 RPL_MOP_STORING_NO_MULTICAST
 #endif
@@ -248,6 +283,10 @@ struct rpl_stats {
   uint16_t malformed_msgs;
   uint16_t resets;
   uint16_t parent_switch;
+  uint16_t dao_sent;
+  uint16_t dao_targets_sent;
+  uint16_t dao_received;
+  uint16_t dao_targets_received;
 };
 typedef struct rpl_stats rpl_stats_t;
 
@@ -314,4 +353,15 @@ void rpl_reset_periodic_timer(void);
 /* Route poisoning. */
 void rpl_poison_routes(rpl_dag_t *, rpl_parent_t *);
 
+#if RPL_WITH_NON_STORING
+/* Non-storing mode graph of the DAG root. */
+void rpl_ns_init(void);
+int rpl_ns_update_node(const uip_ipaddr_t *child, const uip_ipaddr_t *parent,
+                       uint32_t lifetime);
+int rpl_ns_get_path(const uip_ipaddr_t *addr, const uip_ipaddr_t **path,
+                    int max);
+int rpl_ns_num_nodes(void);
+void rpl_ns_periodic(void);
+#endif /* RPL_WITH_NON_STORING */
+
 #endif /* RPL_PRIVATE_H */
@@ -64,6 +64,10 @@ rpl_purge_routes(void)
 {
   uip_ds6_route_t *r;
 
+#if RPL_WITH_NON_STORING
+  rpl_ns_periodic();
+#endif /* RPL_WITH_NON_STORING */
+
   /* First pass, decrement lifetime */
   r = uip_ds6_route_list_head();
 
@@ -254,6 +258,9 @@ rpl_init(void)
 
   rpl_reset_periodic_timer();
   neighbor_info_subscribe(rpl_link_neighbor_callback);
+#if RPL_WITH_NON_STORING
+  rpl_ns_init();
+#endif /* RPL_WITH_NON_STORING */
 
   /* add rpl multicast address */
   uip_create_linklocal_rplnodes_mcast(&rplmaddr);
@@ -113,6 +113,7 @@ struct rpl_parent {
   rpl_metric_container_t mc;
   uip_ipaddr_t addr;
   rpl_rank_t rank;
+  uint16_t path_cost;
   uint8_t link_metric;
   uint8_t dtsn;
   uint8_t updated;
@@ -181,6 +182,14 @@ typedef struct rpl_instance rpl_instance_t;
  *  Updates the metric container for outgoing DIOs in a certain DAG.
  *  If the objective function of the DAG does not use metric containers, 
  *  the function should set the object type to RPL_DAG_MC_NONE.
+ *
+ * parent_path_cost(parent)
+ *
+ *  Returns the cost of the path through a parent, lower being better,
+ *  such that best_parent() prefers the parent with the lowest cost
+ *  unless the preferred parent is close enough. The parents of a DAG
+ *  are kept ordered by this cost. If NULL, best_parent() is called for
+ *  every parent instead.
  */
 struct rpl_of {
   void (*reset)(struct rpl_dag *);
@@ -190,6 +199,7 @@ struct rpl_of {
   rpl_rank_t (*calculate_rank)(rpl_parent_t *, rpl_rank_t);
   void (*update_metric_container)( rpl_instance_t *);
   rpl_ocp_t ocp;
+  uint16_t (*parent_path_cost)(rpl_parent_t *);
 };
 typedef struct rpl_of rpl_of_t;
 /*---------------------------------------------------------------------------*/
@@ -241,5 +251,9 @@ int rpl_update_header_final(uip_ipaddr_t *addr);
 int rpl_verify_header(int);
 void rpl_remove_header(void);
 uint8_t rpl_invert_header(void);
+#if RPL_WITH_NON_STORING
+int rpl_srh_next_hop(uip_ipaddr_t *nexthop);
+int rpl_process_srh_header(void);
+#endif /* RPL_WITH_NON_STORING */
 /*---------------------------------------------------------------------------*/
 #endif /* RPL_H */
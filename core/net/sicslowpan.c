@@ -63,10 +63,12 @@
 #include "net/tcpip.h"
 #include "net/uip.h"
 #include "net/uip-ds6.h"
+#include "net/uip-icmp6.h"
 #include "net/rime.h"
 #include "net/sicslowpan.h"
 #include "net/neighbor-info.h"
 #include "net/netstack.h"
+#include "lib/memb.h"
 
 #if UIP_CONF_IPV6
 
@@ -105,6 +107,35 @@ void uip_log(char *msg);
 #define SICSLOWPAN_MAX_MAC_TRANSMISSIONS 4
 #endif
 
+/* The maximum number of MAC transmissions of each fragment. Losing a
+   fragment loses the whole packet, so fragments may be given a larger
+   budget than the MAC default, which is used if this is 0. */
+#ifdef SICSLOWPAN_CONF_FRAG_MAX_MAC_TRANSMISSIONS
+#define SICSLOWPAN_FRAG_MAX_MAC_TRANSMISSIONS SICSLOWPAN_CONF_FRAG_MAX_MAC_TRANSMISSIONS
+#else
+#define SICSLOWPAN_FRAG_MAX_MAC_TRANSMISSIONS 0
+#endif
+
+/* The number of fragmented packets that can be in transmission at the
+   same time, that is, handed to the MAC layer without all fragments
+   having been reported as sent. */
+#ifdef SICSLOWPAN_CONF_FRAG_TX_NUM
+#define SICSLOWPAN_FRAG_TX_NUM SICSLOWPAN_CONF_FRAG_TX_NUM
+#else
+#define SICSLOWPAN_FRAG_TX_NUM 4
+#endif
+
+/* If set, neighbor discovery and RPL messages are marked with
+   PACKETBUF_ATTR_MAC_PRIORITY, so that a MAC layer with priority
+   queues (CSMA) sends them ahead of data and does not count them
+   against its per-neighbor data limits. Other ICMPv6 messages, such
+   as echo requests, are data. */
+#ifdef SICSLOWPAN_CONF_PRIORITIZE_CONTROL
+#define SICSLOWPAN_PRIORITIZE_CONTROL SICSLOWPAN_CONF_PRIORITIZE_CONTROL
+#else
+#define SICSLOWPAN_PRIORITIZE_CONTROL 0
+#endif
+
 #ifndef SICSLOWPAN_COMPRESSION
 #ifdef SICSLOWPAN_CONF_COMPRESSION
 #define SICSLOWPAN_COMPRESSION SICSLOWPAN_CONF_COMPRESSION
@@ -214,10 +245,6 @@ static uint8_t rime_payload_len;
  */
 static uint8_t uncomp_hdr_len;
 
-/**
- * the result of the last transmitted fragment
- */
-static int last_tx_status;
 /** @} */
 
 #if SICSLOWPAN_CONF_FRAG
@@ -225,35 +252,73 @@ static int last_tx_status;
  *  @{
  */
 
-static uint16_t sicslowpan_len;
-
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * A reassembly context. The buffer contains only the IPv6 packet (no
+ * MAC header, 6lowpan, etc). The parts of the packet that have been
+ * received are marked in a bitmap, with one bit for each 8 bytes, the
+ * unit of the fragment offset, so that fragments can be received in
+ * any order and duplicates can be detected.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+struct sicslowpan_reass {
+  uip_buf_t buf;
+  /** The total length of the IPv6 packet, or 0 if the context is free. */
+  uint16_t len;
+  /** The number of 8-byte units of the packet received so far. */
+  uint16_t received;
+  /** The tag in the fragments being merged. */
+  uint16_t tag;
+  /** The source address of the fragments being merged. */
+  rimeaddr_t sender;
+  /** Reassembly %timer. */
+  struct timer timer;
+  /** The time when the last new fragment was received. */
+  clock_time_t last;
+  uint8_t bitmap[(UIP_BUFSIZE + 63) / 64];
+};
+
+#define REASS_UNITS(len) (((len) + 7) >> 3)
+
+/** A context that has not received a new fragment for a quarter of
+    the reassembly timeout may be evicted to make room for a new
+    packet. */
+#define REASS_IDLE_TIME (SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 64)
+
+static struct sicslowpan_reass reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+static struct sicslowpan_reass_stats reass_stats;
 
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * The buffer that the packet being received is put in: the buffer of
+ * a reassembly context if the packet is fragmented, uip_buf
+ * otherwise.
  */
-static uint16_t processed_ip_in_len;
+static uint8_t *sicslowpan_buf;
+#define sicslowpan_len uip_len
 
 /** Datagram tag to be put in the fragments I send. */
 static uint16_t my_tag;
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
+/**
+ * The transmission state of a fragmented packet. All fragments are
+ * handed to the MAC layer without waiting for the previous ones to be
+ * sent, and the MAC layer reports the result of each fragment with a
+ * pointer to this structure. If a MAC layer that sends at once reports
+ * a failed fragment, the remaining fragments are not produced. A
+ * queueing MAC layer has all fragments before it reports any of them;
+ * they are marked with PACKETBUF_ATTR_MAC_DATAGRAM so that it can drop
+ * the queued fragments of a datagram when one of them fails (CSMA
+ * does).
+ */
+struct frag_tx {
+  /** The number of references: one for each fragment that has not
+      been reported by the MAC layer, and one held by output(). */
+  uint8_t refs;
+  uint8_t failed;
+};
 
-/** When reassembling, the source address of the fragments being merged */
-rimeaddr_t frag_sender;
+MEMB(frag_tx_memb, struct frag_tx, SICSLOWPAN_FRAG_TX_NUM);
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+#define FRAG_TX_FAILED(tx) ((tx) != NULL && (tx)->failed)
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -323,6 +388,29 @@ static struct sicslowpan_addr_context
 addr_contexts[SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS];
 #endif
 
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 2
+/*
+ * With more than two contexts, the contexts are indexed by number and
+ * by a hash of their prefix so that the lookups do not get slower as
+ * contexts are added. The entries are positions in addr_contexts[]
+ * plus one, 0 is an empty entry. The prefix index uses linear probing
+ * and is kept at most half full.
+ */
+#define ADDR_CONTEXT_INDEX 1
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS <= 4
+#define ADDR_CONTEXT_HASH_BITS 3
+#elif SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS <= 8
+#define ADDR_CONTEXT_HASH_BITS 4
+#else
+#define ADDR_CONTEXT_HASH_BITS 5
+#endif
+#define ADDR_CONTEXT_HASH_SIZE (1 << ADDR_CONTEXT_HASH_BITS)
+static uint8_t addr_context_by_prefix[ADDR_CONTEXT_HASH_SIZE];
+static uint8_t addr_context_by_number[16];
+#else
+#define ADDR_CONTEXT_INDEX 0
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 2 */
+
 /** pointer to an address context. */
 static struct sicslowpan_addr_context *context;
 
@@ -362,12 +450,69 @@ static const uint8_t ttl_values[] = {0, 1, 64, 255};
 /** \name HC06 related functions
  * @{                                                                 */
 /*--------------------------------------------------------------------*/
+#if ADDR_CONTEXT_INDEX
+/** \brief hash the 64-bit prefix of a context or an address */
+static uint8_t
+addr_context_hash(const uint8_t *prefix)
+{
+  uint16_t h = 0;
+  int i;
+  for(i = 0; i < 8; i++) {
+    h = ((h << 1) | (h >> 15)) ^ prefix[i];
+  }
+  /* Multiplicative hashing: prefixes that differ only in their last
+     byte should not end up in neighbouring entries. */
+  return (uint16_t)(h * 0x9e37U) >> (16 - ADDR_CONTEXT_HASH_BITS);
+}
+/*--------------------------------------------------------------------*/
+/** \brief rebuild the context index after addr_contexts[] has changed */
+static void
+addr_context_index_init(void)
+{
+  uint8_t i, h, n;
+
+  memset(addr_context_by_prefix, 0, sizeof(addr_context_by_prefix));
+  memset(addr_context_by_number, 0, sizeof(addr_context_by_number));
+  for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+    if(addr_contexts[i].used != 1) {
+      continue;
+    }
+    /* The first context with a number or prefix is the one that is used,
+       as with a linear search. */
+    if(addr_contexts[i].number < sizeof(addr_context_by_number) &&
+       addr_context_by_number[addr_contexts[i].number] == 0) {
+      addr_context_by_number[addr_contexts[i].number] = i + 1;
+    }
+    h = addr_context_hash(addr_contexts[i].prefix);
+    for(n = 0; n < ADDR_CONTEXT_HASH_SIZE; n++) {
+      if(addr_context_by_prefix[h] == 0) {
+        addr_context_by_prefix[h] = i + 1;
+        break;
+      }
+      h = (h + 1) & (ADDR_CONTEXT_HASH_SIZE - 1);
+    }
+  }
+}
+#endif /* ADDR_CONTEXT_INDEX */
+/*--------------------------------------------------------------------*/
 /** \brief find the context corresponding to prefix ipaddr */
 static struct sicslowpan_addr_context*
 addr_context_lookup_by_prefix(uip_ipaddr_t *ipaddr)
 {
+#if ADDR_CONTEXT_INDEX
+  struct sicslowpan_addr_context *c;
+  uint8_t h, n;
+
+  h = addr_context_hash(ipaddr->u8);
+  for(n = 0; n < ADDR_CONTEXT_HASH_SIZE && addr_context_by_prefix[h] != 0; n++) {
+    c = &addr_contexts[addr_context_by_prefix[h] - 1];
+    if(uip_ipaddr_prefixcmp(&c->prefix, ipaddr, 64)) {
+      return c;
+    }
+    h = (h + 1) & (ADDR_CONTEXT_HASH_SIZE - 1);
+  }
 /* Remove code to avoid warnings and save flash if no context is used */
-#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+#elif SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
   int i;
   for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
     if((addr_contexts[i].used == 1) &&
@@ -383,8 +528,13 @@ addr_context_lookup_by_prefix(uip_ipaddr_t *ipaddr)
 static struct sicslowpan_addr_context*
 addr_context_lookup_by_number(uint8_t number)
 {
+#if ADDR_CONTEXT_INDEX
+  if(number < sizeof(addr_context_by_number) &&
+     addr_context_by_number[number] != 0) {
+    return &addr_contexts[addr_context_by_number[number] - 1];
+  }
 /* Remove code to avoid warnings and save flash if no context is used */ 
-#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+#elif SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
   int i;
   for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
     if((addr_contexts[i].used == 1) &&
@@ -495,6 +645,7 @@ static void
 compress_hdr_hc06(rimeaddr_t *rime_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  struct sicslowpan_addr_context *src_context, *dest_context;
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -525,11 +676,11 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
    */
 
 
-  /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
+  /* check if dest or src context exists (for allocating third
+     byte), the contexts are used again below */
+  src_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr);
+  dest_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr);
+  if(dest_context != NULL || src_context != NULL) {
     /* set context flag and increase hc06_ptr */
     PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
     iphc1 |= SICSLOWPAN_IPHC_CID;
@@ -625,8 +776,7 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
     PRINTF("IPHC: compressing unspecified - setting SAC\n");
     iphc1 |= SICSLOWPAN_IPHC_SAC;
     iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
-     != NULL) {
+  } else if((context = src_context) != NULL) {
     /* elide the prefix - indicate by CID and set context + SAC */
     PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
 	   context->number);
@@ -679,7 +829,7 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
     }
   } else {
     /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
+    if((context = dest_context) != NULL) {
       /* elide the prefix */
       iphc1 |= SICSLOWPAN_IPHC_DAC;
       RIME_IPHC_BUF[2] |= context->number;
@@ -1302,6 +1452,24 @@ compress_hdr_ipv6(rimeaddr_t *rime_destaddr)
 /*--------------------------------------------------------------------*/
 /** \name Input/output functions common to all compression schemes
  * @{                                                                 */
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+static void
+frag_tx_hold(struct frag_tx *tx)
+{
+  if(tx != NULL) {
+    tx->refs++;
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+frag_tx_release(struct frag_tx *tx)
+{
+  if(tx != NULL && --tx->refs == 0) {
+    memb_free(&frag_tx_memb, tx);
+  }
+}
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /**
  * Callback function for the MAC packet sent callback
@@ -1315,16 +1483,25 @@ packet_sent(void *ptr, int status, int transmissions)
   if(callback != NULL) {
     callback->output_callback(status);
   }
-  last_tx_status = status;
+#if SICSLOWPAN_CONF_FRAG
+  if(ptr != NULL &&
+     (status == MAC_TX_COLLISION ||
+      status == MAC_TX_ERR ||
+      status == MAC_TX_ERR_FATAL)) {
+    ((struct frag_tx *)ptr)->failed = 1;
+  }
+  frag_tx_release(ptr);
+#endif /* SICSLOWPAN_CONF_FRAG */
 }
 /*--------------------------------------------------------------------*/
 /**
  * \brief This function is called by the 6lowpan code to send out a
  * packet.
  * \param dest the link layer destination address of the packet
+ * \param ptr the pointer that is passed to packet_sent()
  */
 static void
-send_packet(rimeaddr_t *dest)
+send_packet(rimeaddr_t *dest, void *ptr)
 {
   /* Set the link layer destination address for the packet as a
    * packetbuf attribute. The MAC layer can access the destination
@@ -1337,6 +1514,14 @@ send_packet(rimeaddr_t *dest)
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER,(void*)&uip_lladdr);
 #endif
 
+#if SICSLOWPAN_PRIORITIZE_CONTROL
+  if(UIP_IP_BUF->proto == UIP_PROTO_ICMP6 &&
+     ((UIP_ICMP_BUF->type >= ICMP6_RS && UIP_ICMP_BUF->type <= ICMP6_REDIRECT) ||
+      UIP_ICMP_BUF->type == ICMP6_RPL)) {
+    packetbuf_set_attr(PACKETBUF_ATTR_MAC_PRIORITY, 1);
+  }
+#endif /* SICSLOWPAN_PRIORITIZE_CONTROL */
+
   /* Force acknowledge from sender (test hardware autoacks) */
 #if SICSLOWPAN_CONF_ACK_ALL
     packetbuf_set_attr(PACKETBUF_ATTR_RELIABLE, 1);
@@ -1344,7 +1529,7 @@ send_packet(rimeaddr_t *dest)
 
   /* Provide a callback function to receive the result of
      a packet transmission. */
-  NETSTACK_MAC.send(&packet_sent, NULL);
+  NETSTACK_MAC.send(&packet_sent, ptr);
 
   /* If we are sending multiple packets in a row, we need to let the
      watchdog know that we are still alive. */
@@ -1451,7 +1636,10 @@ output(uip_lladdr_t *localdest)
 
   if((int)uip_len - (int)uncomp_hdr_len > (int)MAC_MAX_PAYLOAD - framer_hdrlen - (int)rime_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
-    struct queuebuf *q;
+    uint16_t frag_tag;
+    struct frag_tx *tx;
+    uint8_t failed;
+
     /*
      * The outbound IPv6 packet is too large to fit into a single 15.4
      * packet, so we fragment it into multiple packets and send them.
@@ -1462,6 +1650,14 @@ output(uip_lladdr_t *localdest)
 
     PRINTFO("Fragmentation sending packet len %d\n", uip_len);
 
+    /* If there is no free transmission state, the fragments are sent
+       without it, and are all sent even if one of them fails. */
+    tx = memb_alloc(&frag_tx_memb);
+    if(tx != NULL) {
+      tx->refs = 1;
+      tx->failed = 0;
+    }
+
     /* Create 1st Fragment */
     PRINTFO("sicslowpan output: 1rst fragment ");
 
@@ -1477,7 +1673,8 @@ output(uip_lladdr_t *localdest)
     SET16(RIME_FRAG_PTR, RIME_FRAG_DISPATCH_SIZE,
           ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len));
 /*     RIME_FRAG_BUF->tag = uip_htons(my_tag); */
-    SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, my_tag);
+    frag_tag = my_tag;
+    SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, frag_tag);
     my_tag++;
 
     /* Copy payload and send */
@@ -1487,40 +1684,32 @@ output(uip_lladdr_t *localdest)
     memcpy(rime_ptr + rime_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, rime_payload_len);
     packetbuf_set_datalen(rime_payload_len + rime_hdr_len);
-    q = queuebuf_new_from_packetbuf();
-    if(q == NULL) {
-      PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
-      return 0;
-    }
-    send_packet(&dest);
-    queuebuf_to_packetbuf(q);
-    queuebuf_free(q);
-    q = NULL;
-
-    /* Check tx result. */
-    if((last_tx_status == MAC_TX_COLLISION) ||
-       (last_tx_status == MAC_TX_ERR) ||
-       (last_tx_status == MAC_TX_ERR_FATAL)) {
-      PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
-      return 0;
-    }
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                       SICSLOWPAN_FRAG_MAX_MAC_TRANSMISSIONS);
+    packetbuf_set_attr(PACKETBUF_ATTR_MAC_DATAGRAM, tx != NULL);
+    frag_tx_hold(tx);
+    send_packet(&dest, tx);
 
     /* set processed_ip_out_len to what we already sent from the IP payload*/
     processed_ip_out_len = rime_payload_len + uncomp_hdr_len;
     
     /*
      * Create following fragments
-     * Datagram tag is already in the buffer, we need to set the
-     * FRAGN dispatch and for each fragment, the offset
+     * The MAC layer may have changed the buffer and its attributes
+     * while sending, so each fragment is built from scratch in a
+     * cleared packetbuf: FRAGN dispatch, datagram tag and offset,
+     * followed by the payload straight from uip_buf.
      */
     rime_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
-/*     RIME_FRAG_BUF->dispatch_size = */
-/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
-    SET16(RIME_FRAG_PTR, RIME_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
     rime_payload_len = (MAC_MAX_PAYLOAD - framer_hdrlen - rime_hdr_len) & 0xf8;
-    while(processed_ip_out_len < uip_len) {
+    while(processed_ip_out_len < uip_len && !FRAG_TX_FAILED(tx)) {
       PRINTFO("sicslowpan output: fragment ");
+      packetbuf_clear();
+/*     RIME_FRAG_BUF->dispatch_size = */
+/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
+      SET16(RIME_FRAG_PTR, RIME_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
+      SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, frag_tag);
       RIME_FRAG_PTR[RIME_FRAG_OFFSET] = processed_ip_out_len >> 3;
       
       /* Copy payload and send */
@@ -1533,24 +1722,21 @@ output(uip_lladdr_t *localdest)
       memcpy(rime_ptr + rime_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, rime_payload_len);
       packetbuf_set_datalen(rime_payload_len + rime_hdr_len);
-      q = queuebuf_new_from_packetbuf();
-      if(q == NULL) {
-        PRINTFO("could not allocate queuebuf, dropping fragment\n");
-        return 0;
-      }
-      send_packet(&dest);
-      queuebuf_to_packetbuf(q);
-      queuebuf_free(q);
-      q = NULL;
+      packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                         SICSLOWPAN_FRAG_MAX_MAC_TRANSMISSIONS);
+      packetbuf_set_attr(PACKETBUF_ATTR_MAC_DATAGRAM, tx != NULL);
+      frag_tx_hold(tx);
+      send_packet(&dest, tx);
       processed_ip_out_len += rime_payload_len;
+    }
 
-      /* Check tx result. */
-      if((last_tx_status == MAC_TX_COLLISION) ||
-         (last_tx_status == MAC_TX_ERR) ||
-         (last_tx_status == MAC_TX_ERR_FATAL)) {
-        PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
-        return 0;
-      }
+    /* The fragments that are still queued in the MAC layer release tx
+       when they have been sent. */
+    failed = FRAG_TX_FAILED(tx);
+    frag_tx_release(tx);
+    if(failed) {
+      PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
+      return 0;
     }
 #else /* SICSLOWPAN_CONF_FRAG */
     PRINTFO("sicslowpan output: Packet too large to be sent without fragmentation support; dropping packet\n");
@@ -1565,11 +1751,122 @@ output(uip_lladdr_t *localdest)
     memcpy(rime_ptr + rime_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
            uip_len - uncomp_hdr_len);
     packetbuf_set_datalen(uip_len - uncomp_hdr_len + rime_hdr_len);
-    send_packet(&dest);
+    send_packet(&dest, NULL);
   }
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \brief Free the reassembly contexts that have timed out */
+static void
+reass_timeout(void)
+{
+  struct sicslowpan_reass *r;
+
+  for(r = reass_contexts; r < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; r++) {
+    if(r->len != 0 && timer_expired(&r->timer)) {
+      PRINTFI("sicslowpan input: reassembly timed out (tag %d)\n", r->tag);
+      r->len = 0;
+      reass_stats.timedout++;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the reassembly context of a fragment
+ * \param size The size of the IP packet
+ * \param tag The datagram tag
+ * \param sender The link-layer sender of the fragment
+ *
+ * If there is no context for the packet yet, a free one is set up.
+ * If all are in use, the context that has been idle for the longest
+ * time is evicted if it has been idle for at least REASS_IDLE_TIME.
+ * Otherwise, the packets already being reassembled are kept, and NULL
+ * is returned.
+ */
+static struct sicslowpan_reass *
+reass_lookup(uint16_t size, uint16_t tag, const rimeaddr_t *sender)
+{
+  struct sicslowpan_reass *r, *free, *idle;
+  clock_time_t now;
+
+  now = clock_time();
+  free = idle = NULL;
+  for(r = reass_contexts; r < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; r++) {
+    if(r->len == 0) {
+      if(free == NULL) {
+        free = r;
+      }
+    } else if(r->len == size && r->tag == tag &&
+              rimeaddr_cmp(&r->sender, sender)) {
+      return r;
+    } else if(idle == NULL ||
+              (clock_time_t)(now - r->last) > (clock_time_t)(now - idle->last)) {
+      idle = r;
+    }
+  }
+
+  if(free == NULL) {
+    if((clock_time_t)(now - idle->last) < REASS_IDLE_TIME) {
+      reass_stats.dropped++;
+      return NULL;
+    }
+    PRINTFI("sicslowpan input: evicting reassembly (tag %d)\n", idle->tag);
+    free = idle;
+    reass_stats.evicted++;
+  }
+
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          size, tag);
+  free->len = size;
+  free->received = 0;
+  free->tag = tag;
+  rimeaddr_copy(&free->sender, sender);
+  memset(free->bitmap, 0, sizeof(free->bitmap));
+  timer_set(&free->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  free->last = now;
+  return free;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Mark a part of a packet as received
+ * \param r The reassembly context
+ * \param offset The offset of the part in the IP packet
+ * \param len The length of the part
+ * \return The number of 8-byte units that had not been received before
+ */
+static int
+reass_mark(struct sicslowpan_reass *r, uint16_t offset, uint16_t len)
+{
+  uint16_t i, end;
+  int new;
+
+  end = REASS_UNITS(offset + len);
+  if(end > REASS_UNITS(r->len)) {
+    /* The last fragment may have extraneous bytes at the end. */
+    end = REASS_UNITS(r->len);
+  }
+  new = 0;
+  for(i = offset >> 3; i < end; i++) {
+    if((r->bitmap[i >> 3] & (1 << (i & 7))) == 0) {
+      r->bitmap[i >> 3] |= 1 << (i & 7);
+      new++;
+    }
+  }
+  if(new > 0) {
+    r->received += new;
+    r->last = clock_time();
+  }
+  return new;
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_get_reass_stats(struct sicslowpan_reass_stats *stats)
+{
+  *stats = reass_stats;
+}
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1580,8 +1877,9 @@ output(uip_lladdr_t *localdest)
  *  copied in siclowpan_buf. If the IP packet is complete it is copied
  *  to uip_buf and the IP layer is called.
  *
- * \note We do not check for overlapping sicslowpan fragments
- * (it is a SHALL in the RFC 4944 and should never happen)
+ *  Fragments of up to SICSLOWPAN_REASS_CONTEXTS packets can be
+ *  reassembled at the same time, and may arrive in any order.
+ *  Fragments that have already been received are dropped.
  */
 static void
 input(void)
@@ -1593,7 +1891,8 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
-  uint8_t first_fragment = 0, last_fragment = 0;
+  /* reassembly context of the fragment */
+  struct sicslowpan_reass *reass = NULL;
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1604,11 +1903,8 @@ input(void)
   rime_ptr = packetbuf_dataptr();
 
 #if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  /* cancel the reassemblies that timed out */
+  reass_timeout();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1624,8 +1920,6 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
-      /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
-      first_fragment = 1;
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
       /*
@@ -1639,48 +1933,26 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d rime_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - rime_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - rime_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       break;
     default:
       break;
   }
 
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+  if(frag_size > 0) {
+    if(frag_size > UIP_BUFSIZE) {
+      PRINTFI("sicslowpan input: Dropping fragment of too large packet (%d)\n",
+              frag_size);
       return;
     }
-  } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      rimeaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    reass = reass_lookup(frag_size, frag_tag,
+                         packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    if(reass == NULL) {
+      PRINTFI("sicslowpan input: Dropping fragment, no free reassembly context\n");
+      return;
     }
+    sicslowpan_buf = reass->buf.u8;
+  } else {
+    sicslowpan_buf = uip_buf;
   }
 
   if(rime_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1742,81 +2014,72 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + rime_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          rime_payload_len, req_size, sizeof(sicslowpan_buf));
+          rime_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
 
+#if SICSLOWPAN_CONF_FRAG
+  if(reass != NULL &&
+     reass_mark(reass, (uint16_t)(frag_offset << 3),
+                uncomp_hdr_len + rime_payload_len) == 0) {
+    PRINTFI("sicslowpan input: Dropping duplicate fragment (tag %d, offset %d)\n",
+            frag_tag, frag_offset);
+    reass_stats.duplicates++;
+    return;
+  }
+#endif /* SICSLOWPAN_CONF_FRAG */
+
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), rime_ptr + rime_hdr_len, rime_payload_len);
   
-  /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
-
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
-    }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
-    } else {
-      processed_ip_in_len += rime_payload_len;
+  if(reass != NULL) {
+    PRINTF("reassembled %d of %d units\n", reass->received,
+           REASS_UNITS(reass->len));
+    if(reass->received < REASS_UNITS(reass->len)) {
+      /* Wait for the rest of the packet */
+      return;
     }
-    PRINTF("processed_ip_in_len %d, rime_payload_len %d\n", processed_ip_in_len, rime_payload_len);
-
-  } else {
+    /* We have a full IP packet in sicslowpan_buf, deliver it to the IP
+       stack */
+    PRINTFI("sicslowpan input: IP packet ready (length %d)\n", reass->len);
+    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, reass->len);
+    uip_len = reass->len;
+    reass->len = 0;
+    reass_stats.completed++;
+  } else
 #endif /* SICSLOWPAN_CONF_FRAG */
+  {
     sicslowpan_len = rime_payload_len + uncomp_hdr_len;
-#if SICSLOWPAN_CONF_FRAG
   }
 
-  /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
-   */
-  PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
-    PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
-           sicslowpan_len);
-    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
-    uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-#endif /* SICSLOWPAN_CONF_FRAG */
-
 #if DEBUG
-    {
-      uint16_t ndx;
-      PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
-      for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
-        uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
-        PRINTF("%02x", data);
-      }
-      PRINTF("\n");
+  {
+    uint16_t ndx;
+    PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
+    for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
+      uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
+      PRINTF("%02x", data);
     }
+    PRINTF("\n");
+  }
 #endif
 
 #if SICSLOWPAN_CONF_NEIGHBOR_INFO
-    neighbor_info_packet_received();
+  neighbor_info_packet_received();
 #endif /* SICSLOWPAN_CONF_NEIGHBOR_INFO */
 
-    /* if callback is set then set attributes and call */
-    if(callback) {
-      set_packet_attrs();
-      callback->input_callback();
-    }
-
-    tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
+  /* if callback is set then set attributes and call */
+  if(callback) {
+    set_packet_attrs();
+    callback->input_callback();
   }
-#endif /* SICSLOWPAN_CONF_FRAG */
+
+  tcpip_input();
 }
 /** @} */
 
@@ -1832,6 +2095,10 @@ sicslowpan_init(void)
    */
   tcpip_set_outputfunc(output);
 
+#if SICSLOWPAN_CONF_FRAG
+  memb_init(&frag_tx_memb);
+#endif /* SICSLOWPAN_CONF_FRAG */
+
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
@@ -1875,6 +2142,10 @@ sicslowpan_init(void)
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
 
+#if ADDR_CONTEXT_INDEX
+  addr_context_index_init();
+#endif /* ADDR_CONTEXT_INDEX */
+
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
 }
 /*--------------------------------------------------------------------*/
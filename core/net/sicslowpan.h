@@ -317,6 +317,29 @@ struct sicslowpan_nh_compressor {
 
 };
 
+#if SICSLOWPAN_CONF_FRAG
+/**
+ * Statistics of the reassembly of fragmented packets.
+ */
+struct sicslowpan_reass_stats {
+  /** Packets that were completely reassembled. */
+  unsigned long completed;
+  /** Packets dropped because not all fragments arrived in time. */
+  unsigned long timedout;
+  /** Packets dropped to make room for a new packet. */
+  unsigned long evicted;
+  /** Packets dropped because all reassembly contexts were busy. */
+  unsigned long dropped;
+  /** Fragments dropped because they had already been received. */
+  unsigned long duplicates;
+};
+
+/**
+ * \brief      Get the reassembly statistics
+ * \param stats A pointer to where the statistics are copied
+ */
+void sicslowpan_get_reass_stats(struct sicslowpan_reass_stats *stats);
+#endif /* SICSLOWPAN_CONF_FRAG */
 
 extern const struct network_driver sicslowpan_driver;
 
@@ -541,6 +541,9 @@ tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop;
+#if UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING
+  uip_ipaddr_t srh_nexthop;
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING */
 
   if(uip_len == 0) {
     return;
@@ -563,6 +566,14 @@ tcpip_ipv6_output(void)
     nbr = NULL;
     if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)){
       nexthop = &UIP_IP_BUF->destipaddr;
+#if UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING
+    } else if(rpl_srh_next_hop(&srh_nexthop)) {
+      /* Source routed in a non-storing mode RPL network. */
+      if(uip_len == 0) {
+        return;
+      }
+      nexthop = &srh_nexthop;
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING */
     } else {
       uip_ds6_route_t* locrt;
       locrt = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
@@ -748,6 +759,10 @@ tcpip_uipcall(void)
 PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
+
+  /* Let incoming packets and timers be handled before application
+     events when the scheduler has priorities enabled. */
+  PROCESS_SET_PRIORITY(PROCESS_CURRENT(), PROCESS_PRIORITY_HIGH);
   
 #if UIP_TCP
  {
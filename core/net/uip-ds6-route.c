@@ -49,6 +49,14 @@ MEMB(defaultroutermemb, uip_ds6_defrt_t, UIP_DS6_DEFRT_NB);
 LIST(notificationlist);
 #endif
 
+#if UIP_DS6_ROUTE_HASH
+/* Host routes are found through route_hash, all other routes are on
+   prefix_routes, longest prefix first. Both are chained through
+   index_next, routelist still holds all routes. */
+static uip_ds6_route_t *route_hash[UIP_DS6_ROUTE_HASH];
+static uip_ds6_route_t *prefix_routes;
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
@@ -91,11 +99,68 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH
+static uip_ds6_route_t **
+hash_chain(uip_ipaddr_t *addr)
+{
+  uint32_t h;
+  int i;
+
+  /* The routes of a network mostly differ in their interface
+     identifiers, so only those are hashed (FNV-1a). */
+  h = 2166136261UL;
+  for(i = 8; i < 16; i++) {
+    h = (h ^ addr->u8[i]) * 16777619UL;
+  }
+  return &route_hash[h % UIP_DS6_ROUTE_HASH];
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t **
+index_chain(uip_ds6_route_t *r)
+{
+  if(r->length == 128) {
+    return hash_chain(&r->ipaddr);
+  }
+  return &prefix_routes;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  /* The prefix chain is kept sorted with the longest prefix first, so
+     that the first match is the longest one. */
+  for(p = index_chain(r);
+      *p != NULL && (*p)->length > r->length;
+      p = &(*p)->index_next);
+  r->index_next = *p;
+  *p = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_rm(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  for(p = index_chain(r); *p != NULL; p = &(*p)->index_next) {
+    if(*p == r) {
+      *p = r->index_next;
+      return;
+    }
+  }
+}
+#endif /* UIP_DS6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH
+  memset(route_hash, 0, sizeof(route_hash));
+  prefix_routes = NULL;
+#endif /* UIP_DS6_ROUTE_HASH */
 
   memb_init(&defaultroutermemb);
   list_init(defaultrouterlist);
@@ -122,7 +187,9 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
   uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
@@ -130,6 +197,23 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 
 
   found_route = NULL;
+#if UIP_DS6_ROUTE_HASH
+  /* A host route is the longest possible match. */
+  for(r = *hash_chain(addr); r != NULL; r = r->index_next) {
+    if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+      found_route = r;
+      break;
+    }
+  }
+  if(found_route == NULL) {
+    for(r = prefix_routes; r != NULL; r = r->index_next) {
+      if(uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+        found_route = r;
+        break;
+      }
+    }
+  }
+#else /* UIP_DS6_ROUTE_HASH */
   longestmatch = 0;
   for(r = list_head(routelist);
       r != NULL;
@@ -141,6 +225,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     }
 
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route:");
@@ -169,6 +254,10 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     PRINTF("uip_ds6_route_add: old route already found, updating this one instead: ");
     PRINT6ADDR(ipaddr);
     PRINTF("\n");
+#if UIP_DS6_ROUTE_HASH
+    /* The address and length may change, index the route again below. */
+    index_rm(r);
+#endif /* UIP_DS6_ROUTE_HASH */
   } else {
     /* Allocate a routing entry and add the route to the list */
     r = memb_alloc(&routememb);
@@ -187,6 +276,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
   r->length = length;
   uip_ipaddr_copy(&(r->nexthop), nexthop);
   r->metric = metric;
+#if UIP_DS6_ROUTE_HASH
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -216,6 +308,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
       r != NULL;
       r = list_item_next(r)) {
     if(r == route) {
+#if UIP_DS6_ROUTE_HASH
+      index_rm(route);
+#endif /* UIP_DS6_ROUTE_HASH */
       list_remove(routelist, route);
       memb_free(&routememb, route);
 
@@ -251,11 +346,15 @@ uip_ds6_route_rm_by_nexthop(uip_ipaddr_t *nexthop)
   r = list_head(routelist);
   while(r != NULL) {
     if(uip_ipaddr_cmp(&r->nexthop, nexthop)) {
+#if UIP_DS6_ROUTE_HASH
+      index_rm(r);
+#endif /* UIP_DS6_ROUTE_HASH */
       list_remove(routelist, r);
 #if UIP_DS6_NOTIFICATIONS
       call_route_callback(UIP_DS6_NOTIFICATION_ROUTE_RM,
 			  &r->ipaddr, &r->nexthop);
 #endif
+      memb_free(&routememb, r);
       r = list_head(routelist);
     } else {
       r = list_item_next(r);
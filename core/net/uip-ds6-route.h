@@ -77,6 +77,16 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* UIP_DS6_ROUTE_HASH is the number of hash buckets used to look up
+   host (/128) routes. Shorter routes are kept on a separate chain,
+   sorted by length. If set to 0, uip_ds6_route_lookup() searches the
+   whole routing table. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH
+#define UIP_DS6_ROUTE_HASH UIP_CONF_DS6_ROUTE_HASH
+#else /* UIP_CONF_DS6_ROUTE_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_CONF_DS6_ROUTE_HASH */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -95,6 +105,10 @@ typedef struct rpl_route_entry {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+#if UIP_DS6_ROUTE_HASH
+  /* Next route in the same hash bucket or on the prefix chain */
+  struct uip_ds6_route *index_next;
+#endif /* UIP_DS6_ROUTE_HASH */
   uip_ipaddr_t ipaddr;
   uip_ipaddr_t nexthop;
   uint8_t length;
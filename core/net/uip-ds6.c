@@ -98,6 +98,21 @@ static uip_ds6_prefix_t *locprefix;
 static uip_ds6_nbr_t *locnbr;
 static uip_ds6_defrt_t *locdefrt;
 
+#if UIP_DS6_NBR_HASH
+/* Neighbor hash tables, the free list of the neighbor cache and the
+   LRU list of used neighbors, most recently used first */
+static uip_ds6_nbr_t *nbr_ip_hash[UIP_DS6_NBR_HASH];
+static uip_ds6_nbr_t *nbr_ll_hash[UIP_DS6_NBR_HASH];
+static uip_ds6_nbr_t *nbr_free;
+static uip_ds6_nbr_t *nbr_lru_head, *nbr_lru_tail;
+
+/* Number of least recently used neighbors that are searched for a
+   stale one when the cache is full */
+#define NBR_EVICT_WINDOW 8
+
+static void nbr_index_init(void);
+#endif /* UIP_DS6_NBR_HASH */
+
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_init(void)
@@ -110,6 +125,9 @@ uip_ds6_init(void)
      UIP_DS6_NBR_NB, UIP_DS6_DEFRT_NB, UIP_DS6_PREFIX_NB, UIP_DS6_ROUTE_NB,
      UIP_DS6_ADDR_NB, UIP_DS6_MADDR_NB, UIP_DS6_AADDR_NB);
   memset(uip_ds6_nbr_cache, 0, sizeof(uip_ds6_nbr_cache));
+#if UIP_DS6_NBR_HASH
+  nbr_index_init();
+#endif /* UIP_DS6_NBR_HASH */
   //  memset(uip_ds6_defrt_list, 0, sizeof(uip_ds6_defrt_list));
   memset(uip_ds6_prefix_list, 0, sizeof(uip_ds6_prefix_list));
   memset(&uip_ds6_if, 0, sizeof(uip_ds6_if));
@@ -266,7 +284,7 @@ uip_ds6_periodic(void)
 
 /*---------------------------------------------------------------------------*/
 uint8_t
-uip_ds6_list_loop(uip_ds6_element_t *list, uint8_t size,
+uip_ds6_list_loop(uip_ds6_element_t *list, uint16_t size,
                   uint16_t elementsize, uip_ipaddr_t *ipaddr,
                   uint8_t ipaddrlen, uip_ds6_element_t **out_element)
 {
@@ -291,6 +309,179 @@ uip_ds6_list_loop(uip_ds6_element_t *list, uint8_t size,
   return *out_element != NULL ? FREESPACE : NOSPACE;
 }
 
+#if UIP_DS6_NBR_HASH
+/*---------------------------------------------------------------------------*/
+static unsigned
+nbr_hash(const uint8_t *data, uint8_t len)
+{
+  uint32_t h;
+
+  h = 2166136261UL;
+  while(len-- > 0) {
+    h = (h ^ *data++) * 16777619UL;
+  }
+  return h % UIP_DS6_NBR_HASH;
+}
+/*---------------------------------------------------------------------------*/
+/* Only the interface identifier is hashed, link-local and global
+   addresses of a neighbor end up in the same bucket. */
+#define NBR_IP_HASH(addr) nbr_hash(&(addr)->u8[8], 8)
+#define NBR_LL_HASH(addr) nbr_hash((const uint8_t *)(addr), UIP_LLADDR_LEN)
+/*---------------------------------------------------------------------------*/
+static void
+nbr_index_init(void)
+{
+  int i;
+
+  memset(nbr_ip_hash, 0, sizeof(nbr_ip_hash));
+  memset(nbr_ll_hash, 0, sizeof(nbr_ll_hash));
+  nbr_lru_head = nbr_lru_tail = NULL;
+  nbr_free = NULL;
+  for(i = UIP_DS6_NBR_NB - 1; i >= 0; i--) {
+    uip_ds6_nbr_cache[i].ip_next = nbr_free;
+    nbr_free = &uip_ds6_nbr_cache[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+nbr_ip_lookup(uip_ipaddr_t *ipaddr)
+{
+  uip_ds6_nbr_t *n;
+
+  for(n = nbr_ip_hash[NBR_IP_HASH(ipaddr)]; n != NULL; n = n->ip_next) {
+    if(uip_ipaddr_cmp(&n->ipaddr, ipaddr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_ll_unlink(uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t **p;
+
+  for(p = &nbr_ll_hash[NBR_LL_HASH(&nbr->lladdr)];
+      *p != NULL;
+      p = &(*p)->ll_next) {
+    if(*p == nbr) {
+      *p = nbr->ll_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_ll_link(uip_ds6_nbr_t *nbr)
+{
+  unsigned h;
+
+  h = NBR_LL_HASH(&nbr->lladdr);
+  nbr->ll_next = nbr_ll_hash[h];
+  nbr_ll_hash[h] = nbr;
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_lru_unlink(uip_ds6_nbr_t *nbr)
+{
+  if(nbr->lru_prev != NULL) {
+    nbr->lru_prev->lru_next = nbr->lru_next;
+  } else {
+    nbr_lru_head = nbr->lru_next;
+  }
+  if(nbr->lru_next != NULL) {
+    nbr->lru_next->lru_prev = nbr->lru_prev;
+  } else {
+    nbr_lru_tail = nbr->lru_prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_lru_push(uip_ds6_nbr_t *nbr)
+{
+  nbr->lru_prev = NULL;
+  nbr->lru_next = nbr_lru_head;
+  if(nbr_lru_head != NULL) {
+    nbr_lru_head->lru_prev = nbr;
+  } else {
+    nbr_lru_tail = nbr;
+  }
+  nbr_lru_head = nbr;
+}
+/*---------------------------------------------------------------------------*/
+/* Take a free entry for ipaddr, as uip_ds6_list_loop() would find it */
+static uint8_t
+nbr_find_slot(uip_ipaddr_t *ipaddr)
+{
+  locnbr = nbr_ip_lookup(ipaddr);
+  if(locnbr != NULL) {
+    return FOUND;
+  }
+  if(nbr_free == NULL) {
+    return NOSPACE;
+  }
+  locnbr = nbr_free;
+  nbr_free = locnbr->ip_next;
+  return FREESPACE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_index_add(uip_ds6_nbr_t *nbr)
+{
+  unsigned h;
+
+  h = NBR_IP_HASH(&nbr->ipaddr);
+  nbr->ip_next = nbr_ip_hash[h];
+  nbr_ip_hash[h] = nbr;
+  nbr_ll_link(nbr);
+  nbr_lru_push(nbr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_index_rm(uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t **p;
+
+  for(p = &nbr_ip_hash[NBR_IP_HASH(&nbr->ipaddr)];
+      *p != NULL;
+      p = &(*p)->ip_next) {
+    if(*p == nbr) {
+      *p = nbr->ip_next;
+      break;
+    }
+  }
+  nbr_ll_unlink(nbr);
+  nbr_lru_unlink(nbr);
+  nbr->ip_next = nbr_free;
+  nbr_free = nbr;
+}
+/*---------------------------------------------------------------------------*/
+/* Choose the neighbor to evict from a full cache: a stale one among
+   the least recently used, otherwise the least recently used one.
+   Default routers are never evicted. */
+static uip_ds6_nbr_t *
+nbr_evict_candidate(void)
+{
+  uip_ds6_nbr_t *n, *oldest;
+  int i;
+
+  oldest = NULL;
+  for(n = nbr_lru_tail, i = 0;
+      n != NULL && (i < NBR_EVICT_WINDOW || oldest == NULL);
+      n = n->lru_prev, i++) {
+    if(uip_ds6_defrt_lookup(&n->ipaddr) != NULL) {
+      continue;
+    }
+    if(n->state == NBR_STALE) {
+      return n;
+    }
+    if(oldest == NULL) {
+      oldest = n;
+    }
+  }
+  return oldest;
+}
+#endif /* UIP_DS6_NBR_HASH */
 /*---------------------------------------------------------------------------*/
 uip_ds6_nbr_t *
 uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
@@ -298,10 +489,14 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
 {
   int r;
 
+#if UIP_DS6_NBR_HASH
+  r = nbr_find_slot(ipaddr);
+#else /* UIP_DS6_NBR_HASH */
   r = uip_ds6_list_loop
      ((uip_ds6_element_t *)uip_ds6_nbr_cache, UIP_DS6_NBR_NB,
       sizeof(uip_ds6_nbr_t), ipaddr, 128,
       (uip_ds6_element_t **)&locnbr);
+#endif /* UIP_DS6_NBR_HASH */
 
   if(r == FREESPACE) {
     locnbr->isused = 1;
@@ -320,6 +515,9 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
     stimer_set(&locnbr->reachable, 0);
     stimer_set(&locnbr->sendns, 0);
     locnbr->nscount = 0;
+#if UIP_DS6_NBR_HASH
+    nbr_index_add(locnbr);
+#endif /* UIP_DS6_NBR_HASH */
     PRINTF("Adding neighbor with ip addr ");
     PRINT6ADDR(ipaddr);
     PRINTF("link addr ");
@@ -332,7 +530,11 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
   } else if(r == NOSPACE) {
     /* We did not find any empty slot on the neighbor list, so we need
        to remove one old entry to make room. */
-    uip_ds6_nbr_t *n, *oldest;
+    uip_ds6_nbr_t *oldest;
+#if UIP_DS6_NBR_HASH
+    oldest = nbr_evict_candidate();
+#else /* UIP_DS6_NBR_HASH */
+    uip_ds6_nbr_t *n;
     clock_time_t oldest_time;
 
     oldest = NULL;
@@ -348,6 +550,7 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
         }
       }
     }
+#endif /* UIP_DS6_NBR_HASH */
     if(oldest != NULL) {
       uip_ds6_nbr_rm(oldest);
       return uip_ds6_nbr_add(ipaddr, lladdr, isrouter, state);
@@ -362,6 +565,11 @@ void
 uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
 {
   if(nbr != NULL) {
+#if UIP_DS6_NBR_HASH
+    if(nbr->isused) {
+      nbr_index_rm(nbr);
+    }
+#endif /* UIP_DS6_NBR_HASH */
     nbr->isused = 0;
 #if UIP_CONF_IPV6_QUEUE_PKT
     uip_packetqueue_free(&nbr->packethandle);
@@ -375,6 +583,15 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
 uip_ds6_nbr_t *
 uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr)
 {
+#if UIP_DS6_NBR_HASH
+  locnbr = nbr_ip_lookup(ipaddr);
+  if(locnbr != NULL) {
+    locnbr->last_lookup = clock_time();
+    nbr_lru_unlink(locnbr);
+    nbr_lru_push(locnbr);
+  }
+  return locnbr;
+#else /* UIP_DS6_NBR_HASH */
   if(uip_ds6_list_loop
      ((uip_ds6_element_t *)uip_ds6_nbr_cache, UIP_DS6_NBR_NB,
       sizeof(uip_ds6_nbr_t), ipaddr, 128,
@@ -383,12 +600,22 @@ uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr)
     return locnbr;
   }
   return NULL;
+#endif /* UIP_DS6_NBR_HASH */
 }
 
 /*---------------------------------------------------------------------------*/
 uip_ds6_nbr_t *
 uip_ds6_nbr_ll_lookup(uip_lladdr_t *lladdr)
 {
+#if UIP_DS6_NBR_HASH
+  for(locnbr = nbr_ll_hash[NBR_LL_HASH(lladdr)];
+      locnbr != NULL;
+      locnbr = locnbr->ll_next) {
+    if(!memcmp(lladdr, &locnbr->lladdr, UIP_LLADDR_LEN)) {
+      return locnbr;
+    }
+  }
+#else /* UIP_DS6_NBR_HASH */
   uip_ds6_nbr_t *fin;
 
   for(locnbr = uip_ds6_nbr_cache, fin = locnbr + UIP_DS6_NBR_NB;
@@ -400,8 +627,21 @@ uip_ds6_nbr_ll_lookup(uip_lladdr_t *lladdr)
       }
     }
   }
+#endif /* UIP_DS6_NBR_HASH */
   return NULL;
 }
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_nbr_set_lladdr(uip_ds6_nbr_t *nbr, uip_lladdr_t *lladdr)
+{
+#if UIP_DS6_NBR_HASH
+  nbr_ll_unlink(nbr);
+#endif /* UIP_DS6_NBR_HASH */
+  memcpy(&nbr->lladdr, lladdr, UIP_LLADDR_LEN);
+#if UIP_DS6_NBR_HASH
+  nbr_ll_link(nbr);
+#endif /* UIP_DS6_NBR_HASH */
+}
 
 /*---------------------------------------------------------------------------*/
 #if UIP_CONF_ROUTER
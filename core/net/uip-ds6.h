@@ -63,7 +63,15 @@
 #else
 #define UIP_DS6_NBR_NBU UIP_CONF_DS6_NBR_NBU
 #endif
-#define UIP_DS6_NBR_NB UIP_DS6_NBR_NBS + UIP_DS6_NBR_NBU
+#define UIP_DS6_NBR_NB (UIP_DS6_NBR_NBS + UIP_DS6_NBR_NBU)
+/* Number of hash buckets used to look up neighbors by IP and by link
+   layer address, 0 for a linear search. With the hash, neighbors are
+   also kept in LRU order so that a full cache evicts without a scan. */
+#ifndef UIP_CONF_DS6_NBR_HASH
+#define UIP_DS6_NBR_HASH 0
+#else
+#define UIP_DS6_NBR_HASH UIP_CONF_DS6_NBR_HASH
+#endif
 
 /* Default router list */
 #define UIP_DS6_DEFRT_NBS 0
@@ -170,6 +178,14 @@ typedef struct uip_ds6_nbr {
   struct uip_packetqueue_handle packethandle;
 #define UIP_DS6_NBR_PACKET_LIFETIME CLOCK_SECOND * 4
 #endif                          /*UIP_CONF_QUEUE_PKT */
+#if UIP_DS6_NBR_HASH
+  /* IP hash chain (free list when unused), link layer hash chain and
+     LRU list */
+  struct uip_ds6_nbr *ip_next;
+  struct uip_ds6_nbr *ll_next;
+  struct uip_ds6_nbr *lru_prev;
+  struct uip_ds6_nbr *lru_next;
+#endif /* UIP_DS6_NBR_HASH */
 } uip_ds6_nbr_t;
 
 /** \brief A prefix list entry */
@@ -268,7 +284,7 @@ void uip_ds6_periodic(void);
 
 /** \brief Generic loop routine on an abstract data structure, which generalizes
  * all data structures used in DS6 */
-uint8_t uip_ds6_list_loop(uip_ds6_element_t *list, uint8_t size,
+uint8_t uip_ds6_list_loop(uip_ds6_element_t *list, uint16_t size,
                           uint16_t elementsize, uip_ipaddr_t *ipaddr,
                           uint8_t ipaddrlen,
                           uip_ds6_element_t **out_element);
@@ -280,6 +296,7 @@ uip_ds6_nbr_t *uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
 void uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr);
 uip_ds6_nbr_t *uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr);
 uip_ds6_nbr_t *uip_ds6_nbr_ll_lookup(uip_lladdr_t *lladdr);
+void uip_ds6_nbr_set_lladdr(uip_ds6_nbr_t *nbr, uip_lladdr_t *lladdr);
 
 /** @} */
 
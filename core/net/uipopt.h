@@ -473,6 +473,16 @@
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * The number of packets that can be reassembled at the same time at
+ * the 6lowpan layer. Each one needs a buffer of UIP_BUFSIZE bytes.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -50,6 +50,19 @@ LIST(ctimer_list);
 
 static char initialized;
 
+/* The ctimer process keeps a single event timer set to the expiration
+   time of the first callback timer on the list. */
+static struct etimer ctimer_etimer;
+
+/* The maximum number of callback timers that are run from one
+   invocation of the ctimer process before other processes get to
+   run. */
+#ifdef CTIMER_CONF_MAX_BATCH
+#define CTIMER_MAX_BATCH CTIMER_CONF_MAX_BATCH
+#else /* CTIMER_CONF_MAX_BATCH */
+#define CTIMER_MAX_BATCH 16
+#endif /* CTIMER_CONF_MAX_BATCH */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -58,31 +71,117 @@ static char initialized;
 #define PRINTF(...)
 #endif
 
-/*---------------------------------------------------------------------------*/
 PROCESS(ctimer_process, "Ctimer process");
-PROCESS_THREAD(ctimer_process, ev, data)
+/*---------------------------------------------------------------------------*/
+/* The time left until c expires, with expired timers counting as zero
+   time left. The order of two timers by this measure does not change
+   as time passes. */
+static clock_time_t
+time_left(struct ctimer *c, clock_time_t now)
+{
+  if((clock_time_t)(now - c->etimer.timer.start) >=
+     c->etimer.timer.interval) {
+    return 0;
+  }
+  return c->etimer.timer.start + c->etimer.timer.interval - now;
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule(void)
 {
   struct ctimer *c;
-  PROCESS_BEGIN();
 
-  for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-    etimer_set(&c->etimer, c->etimer.timer.interval);
+  c = list_head(ctimer_list);
+  if(c == NULL) {
+    etimer_stop(&ctimer_etimer);
+  } else {
+    PROCESS_CONTEXT_BEGIN(&ctimer_process);
+    etimer_set(&ctimer_etimer, time_left(c, clock_time()));
+    PROCESS_CONTEXT_END(&ctimer_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Insert c into the list, which is kept ordered by expiration time. */
+static void
+add_ctimer(struct ctimer *c)
+{
+  struct ctimer *t, *prev;
+  clock_time_t now, left;
+
+  list_remove(ctimer_list, c);
+  c->etimer.p = &ctimer_process;
+
+  if(!initialized) {
+    list_add(ctimer_list, c);
+    return;
+  }
+
+  now = clock_time();
+  left = time_left(c, now);
+  prev = NULL;
+  for(t = list_head(ctimer_list);
+      t != NULL && time_left(t, now) <= left;
+      t = t->next) {
+    prev = t;
+  }
+  list_insert(ctimer_list, prev, c);
+
+  if(prev == NULL) {
+    /* The new timer is the first to expire. */
+    schedule();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_expired(void)
+{
+  struct ctimer *c;
+  int n;
+
+  for(n = 0; n < CTIMER_MAX_BATCH; n++) {
+    c = list_head(ctimer_list);
+    if(c == NULL || !timer_expired(&c->etimer.timer)) {
+      break;
+    }
+    list_remove(ctimer_list, c);
+    c->etimer.p = PROCESS_NONE;
+    PROCESS_CONTEXT_BEGIN(c->p);
+    if(c->f != NULL) {
+      c->f(c->ptr);
+    }
+    PROCESS_CONTEXT_END(c->p);
+  }
+
+  c = list_head(ctimer_list);
+  if(c != NULL && timer_expired(&c->etimer.timer)) {
+    /* More timers have expired; let other processes run before we
+       continue with them. */
+    process_poll(&ctimer_process);
+  } else {
+    schedule();
   }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ctimer_process, ev, data)
+{
+  struct ctimer *c, *next;
+  PROCESS_BEGIN();
+
+  /* Timers set before the process was started hold only their
+     interval, so start them now and put them in order. */
   initialized = 1;
+  c = list_head(ctimer_list);
+  list_init(ctimer_list);
+  while(c != NULL) {
+    next = c->next;
+    timer_set(&c->etimer.timer, c->etimer.timer.interval);
+    add_ctimer(c);
+    c = next;
+  }
 
   while(1) {
-    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
-    for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-      if(&c->etimer == data) {
-	list_remove(ctimer_list, c);
-	PROCESS_CONTEXT_BEGIN(c->p);
-	if(c->f != NULL) {
-	  c->f(c->ptr);
-	}
-	PROCESS_CONTEXT_END(c->p);
-	break;
-      }
-    }
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER || ev == PROCESS_EVENT_POLL);
+    run_expired();
   }
   PROCESS_END();
 }
@@ -104,52 +203,39 @@ ctimer_set(struct ctimer *c, clock_time_t t,
   c->f = f;
   c->ptr = ptr;
   if(initialized) {
-    PROCESS_CONTEXT_BEGIN(&ctimer_process);
-    etimer_set(&c->etimer, t);
-    PROCESS_CONTEXT_END(&ctimer_process);
+    timer_set(&c->etimer.timer, t);
   } else {
     c->etimer.timer.interval = t;
   }
 
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
+  add_ctimer(c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_reset(struct ctimer *c)
 {
   if(initialized) {
-    PROCESS_CONTEXT_BEGIN(&ctimer_process);
-    etimer_reset(&c->etimer);
-    PROCESS_CONTEXT_END(&ctimer_process);
+    timer_reset(&c->etimer.timer);
   }
 
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
+  add_ctimer(c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_restart(struct ctimer *c)
 {
   if(initialized) {
-    PROCESS_CONTEXT_BEGIN(&ctimer_process);
-    etimer_restart(&c->etimer);
-    PROCESS_CONTEXT_END(&ctimer_process);
+    timer_restart(&c->etimer.timer);
   }
 
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
+  add_ctimer(c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_stop(struct ctimer *c)
 {
-  if(initialized) {
-    etimer_stop(&c->etimer);
-  } else {
-    c->etimer.next = NULL;
-    c->etimer.p = PROCESS_NONE;
-  }
+  c->etimer.next = NULL;
+  c->etimer.p = PROCESS_NONE;
   list_remove(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
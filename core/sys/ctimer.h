@@ -10,6 +10,11 @@
  * The ctimer module provides a timer mechanism that calls a specified
  * C function when a ctimer expires.
  *
+ * The callback timers are kept in a list ordered by expiration time
+ * and are run by the ctimer process, which uses a single event timer
+ * for the first timer to expire and runs all expired callback timers
+ * when it fires.
+ *
  */
 
 /*
@@ -54,6 +54,212 @@ static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_HEAP
+/*
+ * The pending timers are kept in a pairing heap rooted at
+ * timerlist. Each timer points to its first child and to its next
+ * sibling (the next field). The prev field points to the previous
+ * sibling, or to the parent for the first child in a sibling list,
+ * and is NULL for the root.
+ *
+ * Timers are ordered by the time left until they expire, with timers
+ * that already have expired counting as zero time left. This order
+ * does not change as time passes, which is what makes it possible to
+ * keep it in a heap even though the clock wraps.
+ */
+static clock_time_t
+time_left(struct etimer *t, clock_time_t now)
+{
+  if((clock_time_t)(now - t->timer.start) >= t->timer.interval) {
+    return 0;
+  }
+  return t->timer.start + t->timer.interval - now;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+meld(struct etimer *a, struct etimer *b, clock_time_t now)
+{
+  struct etimer *t;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+  if(time_left(b, now) < time_left(a, now)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+
+  /* Make b the first child of a. */
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+merge_pairs(struct etimer *first, clock_time_t now)
+{
+  struct etimer *a, *b, *stack, *root;
+
+  /* Meld the siblings pairwise from left to right, pushing each pair
+     onto a stack linked through the next pointers... */
+  stack = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    if(b != NULL) {
+      first = b->next;
+      b->next = b->prev = NULL;
+    } else {
+      first = NULL;
+    }
+    a->next = a->prev = NULL;
+    a = meld(a, b, now);
+    a->next = stack;
+    stack = a;
+  }
+
+  /* ...and then meld the pairs together from right to left. */
+  root = NULL;
+  while(stack != NULL) {
+    a = stack;
+    stack = a->next;
+    a->next = NULL;
+    root = meld(a, root, now);
+  }
+  return root;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_pending(struct etimer *t)
+{
+  struct etimer *u;
+
+  if(t->p == PROCESS_NONE) {
+    return 0;
+  }
+
+  /* A timer that has never been set may contain anything, so t is
+     searched for from the root and only the links of timers on the
+     heap are followed, as in the list backend. */
+  u = timerlist;
+  while(u != NULL) {
+    if(u == t) {
+      return 1;
+    }
+    if(u->child != NULL) {
+      u = u->child;
+      continue;
+    }
+    while(u != NULL && u->next == NULL) {
+      /* Climb to the parent of the sibling list. */
+      while(u->prev != NULL && u->prev->child != u) {
+        u = u->prev;
+      }
+      u = u->prev;
+    }
+    if(u != NULL) {
+      u = u->next;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *t)
+{
+  t->child = t->next = t->prev = NULL;
+  timerlist = meld(timerlist, t, clock_time());
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct etimer *t)
+{
+  clock_time_t now;
+
+  now = clock_time();
+  if(t == timerlist) {
+    timerlist = merge_pairs(t->child, now);
+  } else {
+    if(t->prev->child == t) {
+      t->prev->child = t->next;
+    } else {
+      t->prev->next = t->next;
+    }
+    if(t->next != NULL) {
+      t->next->prev = t->prev;
+    }
+    timerlist = meld(timerlist, merge_pairs(t->child, now), now);
+  }
+  t->child = t->next = t->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process_timers(struct process *p)
+{
+  struct etimer *t, *work, *last;
+  clock_time_t now;
+
+  /* Take the heap apart into a work list of all timers, and meld
+     every timer that does not belong to p back into a new heap. */
+  now = clock_time();
+  work = timerlist;
+  timerlist = NULL;
+  while(work != NULL) {
+    t = work;
+    work = t->next;
+    if(t->child != NULL) {
+      for(last = t->child; last->next != NULL; last = last->next);
+      last->next = work;
+      work = t->child;
+    }
+    t->child = t->next = t->prev = NULL;
+    if(t->p == p) {
+      t->p = PROCESS_NONE;
+    } else {
+      timerlist = meld(timerlist, t, now);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if(timerlist == NULL) {
+    next_expiration = 0;
+  } else {
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_expired(void)
+{
+  struct etimer *t;
+
+  while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+    t = timerlist;
+    if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+      etimer_request_poll();
+      break;
+    }
+    remove_timer(t);
+    /* Reset the process ID of the event timer, to signal that the
+       etimer has expired. This is later checked in the
+       etimer_expired() function. */
+    t->p = PROCESS_NONE;
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_HEAP */
 static void
 update_time(void)
 {
@@ -77,10 +283,88 @@ update_time(void)
   }
 }
 /*---------------------------------------------------------------------------*/
-PROCESS_THREAD(etimer_process, ev, data)
+static int
+is_pending(struct etimer *timer)
+{
+  struct etimer *t;
+
+  if(timer->p != PROCESS_NONE) {
+    for(t = timerlist; t != NULL; t = t->next) {
+      if(t == timer) {
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *t)
+{
+  t->next = timerlist;
+  timerlist = t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process_timers(struct process *p)
+{
+  struct etimer *t;
+
+  while(timerlist != NULL && timerlist->p == p) {
+    timerlist->p = PROCESS_NONE;
+    timerlist = timerlist->next;
+  }
+
+  if(timerlist != NULL) {
+    t = timerlist;
+    while(t->next != NULL) {
+      if(t->next->p == p) {
+	t->next->p = PROCESS_NONE;
+	t->next = t->next->next;
+      } else
+	t = t->next;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_expired(void)
 {
   struct etimer *t, *u;
-	
+
+  /* Unlink all expired timers in a single pass over the list and
+     only recalculate the next expiration time once at the end. */
+  u = NULL;
+  t = timerlist;
+  while(t != NULL) {
+    if(timer_expired(&t->timer)) {
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+
+	/* Reset the process ID of the event timer, to signal that the
+	   etimer has expired. This is later checked in the
+	   etimer_expired() function. */
+	t->p = PROCESS_NONE;
+	if(u != NULL) {
+	  u->next = t->next;
+	} else {
+	  timerlist = t->next;
+	}
+	t->next = NULL;
+	t = (u != NULL) ? u->next : timerlist;
+	continue;
+      } else {
+	etimer_request_poll();
+      }
+    }
+    u = t;
+    t = t->next;
+  }
+  update_time();
+}
+#endif /* ETIMER_HEAP */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
   PROCESS_BEGIN();
 
   timerlist = NULL;
@@ -89,53 +373,11 @@ PROCESS_THREAD(etimer_process, ev, data)
     PROCESS_YIELD();
 
     if(ev == PROCESS_EVENT_EXITED) {
-      struct process *p = data;
-
-      while(timerlist != NULL && timerlist->p == p) {
-	timerlist = timerlist->next;
-      }
-
-      if(timerlist != NULL) {
-	t = timerlist;
-	while(t->next != NULL) {
-	  if(t->next->p == p) {
-	    t->next = t->next->next;
-	  } else
-	    t = t->next;
-	}
-      }
-      continue;
-    } else if(ev != PROCESS_EVENT_POLL) {
-      continue;
-    }
-
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
-      }
-      u = t;
+      remove_process_timers(data);
+      update_time();
+    } else if(ev == PROCESS_EVENT_POLL) {
+      run_expired();
     }
-    
   }
   
   PROCESS_END();
@@ -150,25 +392,19 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
-  if(timer->p != PROCESS_NONE) {
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-        timer->p = PROCESS_CURRENT();
-	update_time();
-	return;
-      }
-    }
+  if(is_pending(timer)) {
+#if ETIMER_HEAP
+    /* The expiration time has changed, so the timer must be moved to
+       its new place in the heap. */
+    remove_timer(timer);
+    insert_timer(timer);
+#endif /* ETIMER_HEAP */
+  } else {
+    insert_timer(timer);
   }
-
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
 
   update_time();
 }
@@ -197,7 +433,17 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_HEAP
+  if(is_pending(et)) {
+    remove_timer(et);
+    et->timer.start += timediff;
+    insert_timer(et);
+  } else {
+    et->timer.start += timediff;
+  }
+#else /* ETIMER_HEAP */
   et->timer.start += timediff;
+#endif /* ETIMER_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -234,6 +480,12 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_HEAP
+  if(is_pending(et)) {
+    remove_timer(et);
+    update_time();
+  }
+#else /* ETIMER_HEAP */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -257,6 +509,8 @@ etimer_stop(struct etimer *et)
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
+#endif /* ETIMER_HEAP */
+
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
@@ -65,6 +65,23 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * ETIMER_CONF_HEAP selects how the pending event timers are kept. By
+ * default they are kept in an unsorted list, which is the smallest
+ * option but costs a scan of all timers for every timer that is set
+ * or that expires. With ETIMER_CONF_HEAP set to 1 the timers are kept
+ * in a pairing heap ordered by expiration time instead, which makes
+ * setting and stopping a timer O(log n) and lets the etimer process
+ * drain all expired timers in a single pass, at the cost of two extra
+ * pointers per event timer. This is intended for systems with many
+ * concurrent timers, such as native gateways.
+ */
+#ifdef ETIMER_CONF_HEAP
+#define ETIMER_HEAP ETIMER_CONF_HEAP
+#else /* ETIMER_CONF_HEAP */
+#define ETIMER_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -77,6 +94,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP
+  struct etimer *child, *prev;
+#endif /* ETIMER_HEAP */
 };
 
 /**
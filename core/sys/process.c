@@ -44,9 +44,16 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_EVENT_OVERFLOW
+#include "lib/memb.h"
+#endif /* PROCESS_EVENT_OVERFLOW */
+#if PROCESS_TIMING
+#include "sys/rtimer.h"
+#endif /* PROCESS_TIMING */
 
 /*
  * Pointer to the currently running process structure.
@@ -63,22 +70,78 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_TIMING
+  rtimer_clock_t posted;
+#endif /* PROCESS_TIMING */
 };
 
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
+#if PROCESS_PRIORITIES
+/* Events posted to high priority processes. */
+static process_num_events_t high_nevents, high_fevent;
+static struct event_data high_events[PROCESS_CONF_NUMEVENTS_HIGH];
+
+/* Polled processes, one queue per priority level, linked through
+   the pollnext pointer. */
+static struct process *poll_head[2], *poll_tail[2];
+/* The polled processes that do_poll() currently is working through. */
+static struct process *polling;
+
+#define NEVENTS_HIGH() high_nevents
+#else /* PROCESS_PRIORITIES */
+#define NEVENTS_HIGH() 0
+#endif /* PROCESS_PRIORITIES */
+
+#if PROCESS_EVENT_OVERFLOW
+/* Events that did not fit in the event queue. They are moved into
+   the queue, oldest first, as soon as there is room. */
+struct overflow_event {
+  struct overflow_event *next;
+  struct event_data e;
+};
+MEMB(overflow_memb, struct overflow_event, PROCESS_EVENT_OVERFLOW);
+static struct overflow_event *overflow_head, *overflow_tail;
+static unsigned short overflow_nevents;
+#define NEVENTS_OVERFLOW() overflow_nevents
+#else /* PROCESS_EVENT_OVERFLOW */
+#define NEVENTS_OVERFLOW() 0
+#endif /* PROCESS_EVENT_OVERFLOW */
+
+#define NEVENTS() (nevents + NEVENTS_HIGH() + NEVENTS_OVERFLOW())
+
+#if PROCESS_EVENT_STATS
+static unsigned short queue_max, queue_overflowed, queue_dropped;
+#endif /* PROCESS_EVENT_STATS */
+
+#if PROCESS_TIMING
+/* The time spent in processes called from the running process. */
+static rtimer_clock_t nested_time;
+#endif /* PROCESS_TIMING */
+
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
 #endif
 
 static volatile unsigned char poll_requested;
 
+/* PROCESS_CONF_POLL_HOOK() is called when a process is polled, so
+   that a sleeping platform main loop can be woken up. */
+#ifdef PROCESS_CONF_POLL_HOOK
+#define PROCESS_POLL_HOOK() PROCESS_CONF_POLL_HOOK()
+#else /* PROCESS_CONF_POLL_HOOK */
+#define PROCESS_POLL_HOOK()
+#endif /* PROCESS_CONF_POLL_HOOK */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+#if PROCESS_PRIORITIES
+static void remove_poll(struct process *p);
+#endif /* PROCESS_PRIORITIES */
 
 #define DEBUG 0
 #if DEBUG
@@ -113,6 +176,12 @@ process_start(struct process *p, const char *arg)
   process_list = p;
   p->state = PROCESS_STATE_RUNNING;
   PT_INIT(&p->pt);
+#if PROCESS_EVENT_STATS
+  memset(&p->evstats, 0, sizeof(p->evstats));
+#endif /* PROCESS_EVENT_STATS */
+#if PROCESS_TIMING
+  memset(&p->timing, 0, sizeof(p->timing));
+#endif /* PROCESS_TIMING */
 
   PRINTF("process: starting '%s'\n", PROCESS_NAME_STRING(p));
 
@@ -138,6 +207,9 @@ exit_process(struct process *p, struct process *fromprocess)
   if(process_is_running(p)) {
     /* Process was running */
     p->state = PROCESS_STATE_NONE;
+#if PROCESS_PRIORITIES
+    remove_poll(p);
+#endif /* PROCESS_PRIORITIES */
 
     /*
      * Post a synchronous event to all processes to inform them that
@@ -175,6 +247,9 @@ static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_TIMING
+  rtimer_clock_t start, elapsed, saved;
+#endif /* PROCESS_TIMING */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +262,21 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_TIMING
+    saved = nested_time;
+    nested_time = 0;
+    start = RTIMER_NOW();
+#endif /* PROCESS_TIMING */
     ret = p->thread(&p->pt, ev, data);
+#if PROCESS_TIMING
+    elapsed = RTIMER_NOW() - start;
+    p->timing.calls++;
+    p->timing.time += (rtimer_clock_t)(elapsed - nested_time);
+    if((rtimer_clock_t)(elapsed - nested_time) > p->timing.max_time) {
+      p->timing.max_time = (rtimer_clock_t)(elapsed - nested_time);
+    }
+    nested_time = saved + elapsed;
+#endif /* PROCESS_TIMING */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -210,6 +299,19 @@ process_init(void)
   lastevent = PROCESS_EVENT_MAX;
 
   nevents = fevent = 0;
+#if PROCESS_PRIORITIES
+  high_nevents = high_fevent = 0;
+  poll_head[0] = poll_head[1] = poll_tail[0] = poll_tail[1] = NULL;
+  polling = NULL;
+#endif /* PROCESS_PRIORITIES */
+#if PROCESS_EVENT_OVERFLOW
+  memb_init(&overflow_memb);
+  overflow_head = overflow_tail = NULL;
+  overflow_nevents = 0;
+#endif /* PROCESS_EVENT_OVERFLOW */
+#if PROCESS_EVENT_STATS
+  process_reset_queue_stats();
+#endif /* PROCESS_EVENT_STATS */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -221,6 +323,82 @@ process_init(void)
  * Call each process' poll handler.
  */
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PRIORITIES
+static void
+unlink_poll(struct process **head, struct process **tail, struct process *p)
+{
+  struct process *q, *prev;
+
+  prev = NULL;
+  for(q = *head; q != NULL; prev = q, q = q->pollnext) {
+    if(q == p) {
+      if(prev == NULL) {
+	*head = p->pollnext;
+      } else {
+	prev->pollnext = p->pollnext;
+      }
+      if(tail != NULL && *tail == p) {
+	*tail = prev;
+      }
+      p->pollnext = NULL;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_poll(struct process *p)
+{
+  if(p->needspoll) {
+    unlink_poll(&poll_head[0], &poll_tail[0], p);
+    unlink_poll(&poll_head[1], &poll_tail[1], p);
+    unlink_poll(&polling, NULL, p);
+    p->needspoll = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  priority = priority ? PROCESS_PRIORITY_HIGH : PROCESS_PRIORITY_NORMAL;
+  if(priority != p->priority && p->needspoll) {
+    /* Move a pending poll to the queue of the new priority. */
+    remove_poll(p);
+    p->priority = priority;
+    process_poll(p);
+  }
+  p->priority = priority;
+}
+/*---------------------------------------------------------------------------*/
+static void
+do_poll(void)
+{
+  struct process *p;
+  int prio;
+
+  poll_requested = 0;
+
+  /* Call the processes that were polled before we started, high
+     priority processes first. Processes that are polled while we are
+     doing this are queued until the next time. */
+  for(prio = PROCESS_PRIORITY_HIGH; prio >= PROCESS_PRIORITY_NORMAL; prio--) {
+    polling = poll_head[prio];
+    poll_head[prio] = poll_tail[prio] = NULL;
+    while(polling != NULL) {
+      p = polling;
+      polling = p->pollnext;
+      p->pollnext = NULL;
+      p->needspoll = 0;
+      p->state = PROCESS_STATE_RUNNING;
+      call_process(p, PROCESS_EVENT_POLL, NULL);
+    }
+  }
+  if(poll_head[PROCESS_PRIORITY_HIGH] != NULL ||
+     poll_head[PROCESS_PRIORITY_NORMAL] != NULL) {
+    poll_requested = 1;
+  }
+}
+#else /* PROCESS_PRIORITIES */
 static void
 do_poll(void)
 {
@@ -236,6 +414,7 @@ do_poll(void)
     }
   }
 }
+#endif /* PROCESS_PRIORITIES */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
@@ -249,6 +428,9 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+#if PROCESS_TIMING
+  static rtimer_clock_t posted;
+#endif /* PROCESS_TIMING */
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -258,6 +440,18 @@ do_event(void)
    * call the poll handlers inbetween.
    */
 
+#if PROCESS_PRIORITIES
+  if(high_nevents > 0) {
+    ev = high_events[high_fevent].ev;
+    data = high_events[high_fevent].data;
+    receiver = high_events[high_fevent].p;
+#if PROCESS_TIMING
+    posted = high_events[high_fevent].posted;
+#endif /* PROCESS_TIMING */
+    high_fevent = (high_fevent + 1) % PROCESS_CONF_NUMEVENTS_HIGH;
+    --high_nevents;
+  } else
+#endif /* PROCESS_PRIORITIES */
   if(nevents > 0) {
     
     /* There are events that we should deliver. */
@@ -265,57 +459,166 @@ do_event(void)
     
     data = events[fevent].data;
     receiver = events[fevent].p;
+#if PROCESS_TIMING
+    posted = events[fevent].posted;
+#endif /* PROCESS_TIMING */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
     --nevents;
 
-    /* If this is a broadcast event, we deliver it to all events, in
-       order of their priority. */
-    if(receiver == PROCESS_BROADCAST) {
-      for(p = process_list; p != NULL; p = p->next) {
-
-	/* If we have been requested to poll a process, we do this in
-	   between processing the broadcast event. */
-	if(poll_requested) {
-	  do_poll();
-	}
-	call_process(p, ev, data);
+#if PROCESS_EVENT_OVERFLOW
+    if(overflow_head != NULL) {
+      /* Move the oldest overflowed event into the free slot. */
+      struct overflow_event *o = overflow_head;
+      events[(fevent + nevents) % PROCESS_CONF_NUMEVENTS] = o->e;
+      ++nevents;
+      overflow_head = o->next;
+      if(overflow_head == NULL) {
+	overflow_tail = NULL;
       }
-    } else {
-      /* This is not a broadcast event, so we deliver it to the
-	 specified process. */
-      /* If the event was an INIT event, we should also update the
-	 state of the process. */
-      if(ev == PROCESS_EVENT_INIT) {
-	receiver->state = PROCESS_STATE_RUNNING;
+      --overflow_nevents;
+      memb_free(&overflow_memb, o);
+    }
+#endif /* PROCESS_EVENT_OVERFLOW */
+  } else {
+    return;
+  }
+
+  /* If this is a broadcast event, we deliver it to all events, in
+     order of their priority. */
+  if(receiver == PROCESS_BROADCAST) {
+    for(p = process_list; p != NULL; p = p->next) {
+
+      /* If we have been requested to poll a process, we do this in
+	 between processing the broadcast event. */
+      if(poll_requested) {
+	do_poll();
       }
+      call_process(p, ev, data);
+    }
+  } else {
+    /* This is not a broadcast event, so we deliver it to the
+       specified process. */
+    /* If the event was an INIT event, we should also update the
+       state of the process. */
+    if(ev == PROCESS_EVENT_INIT) {
+      receiver->state = PROCESS_STATE_RUNNING;
+    }
 
-      /* Make sure that the process actually is running. */
-      call_process(receiver, ev, data);
+#if PROCESS_EVENT_STATS
+    receiver->evstats.delivered++;
+#endif /* PROCESS_EVENT_STATS */
+#if PROCESS_TIMING
+    {
+      rtimer_clock_t latency = RTIMER_NOW() - posted;
+      receiver->timing.events++;
+      receiver->timing.latency += latency;
+      if(latency > receiver->timing.max_latency) {
+	receiver->timing.max_latency = latency;
+      }
     }
+#endif /* PROCESS_TIMING */
+
+    /* Make sure that the process actually is running. */
+    call_process(receiver, ev, data);
   }
 }
 /*---------------------------------------------------------------------------*/
 int
 process_run(void)
 {
-  /* Process poll events. */
-  if(poll_requested) {
-    do_poll();
-  }
+  int i;
 
-  /* Process one event from the queue */
-  do_event();
+  for(i = 0; i < PROCESS_CONF_EVENTS_PER_RUN; i++) {
+    /* Process poll events. */
+    if(poll_requested) {
+      do_poll();
+    }
 
-  return nevents + poll_requested;
+    if(NEVENTS() == 0) {
+      break;
+    }
+
+    /* Process one event from the queue */
+    do_event();
+  }
+
+  return NEVENTS() + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
 int
 process_nevents(void)
 {
-  return nevents + poll_requested;
+  return NEVENTS() + poll_requested;
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_EVENT_STATS
+const struct process_event_stats *
+process_get_event_stats(struct process *p)
+{
+  return &p->evstats;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_get_queue_stats(struct process_queue_stats *stats)
+{
+  stats->size = PROCESS_CONF_NUMEVENTS + PROCESS_EVENT_OVERFLOW;
+#if PROCESS_PRIORITIES
+  stats->size += PROCESS_CONF_NUMEVENTS_HIGH;
+#endif /* PROCESS_PRIORITIES */
+  stats->queued = NEVENTS();
+  stats->max = queue_max;
+  stats->overflowed = queue_overflowed;
+  stats->dropped = queue_dropped;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_reset_queue_stats(void)
+{
+  queue_max = NEVENTS();
+  queue_overflowed = 0;
+  queue_dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+process_event_queue_congested(void)
+{
+  return NEVENTS() >= PROCESS_EVENT_HIGH_WATER;
+}
+#endif /* PROCESS_EVENT_STATS */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_TIMING
+const struct process_timing *
+process_get_timing(struct process *p)
+{
+  return &p->timing;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_reset_timing(void)
+{
+  struct process *p;
+
+  for(p = process_list; p != NULL; p = p->next) {
+    memset(&p->timing, 0, sizeof(p->timing));
+  }
+}
+#endif /* PROCESS_TIMING */
+/*---------------------------------------------------------------------------*/
+static int
+event_posted(struct process *p)
+{
+#if PROCESS_EVENT_STATS
+  if(p != PROCESS_BROADCAST) {
+    p->evstats.posted++;
+  }
+  if(NEVENTS() > queue_max) {
+    queue_max = NEVENTS();
+  }
+#endif /* PROCESS_EVENT_STATS */
+  return PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -332,6 +635,50 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
+#if PROCESS_PRIORITIES
+  if(p != PROCESS_BROADCAST && p->priority == PROCESS_PRIORITY_HIGH &&
+     high_nevents < PROCESS_CONF_NUMEVENTS_HIGH) {
+    snum = (process_num_events_t)(high_fevent + high_nevents) %
+      PROCESS_CONF_NUMEVENTS_HIGH;
+    high_events[snum].ev = ev;
+    high_events[snum].data = data;
+    high_events[snum].p = p;
+#if PROCESS_TIMING
+    high_events[snum].posted = RTIMER_NOW();
+#endif /* PROCESS_TIMING */
+    ++high_nevents;
+    return event_posted(p);
+  }
+#endif /* PROCESS_PRIORITIES */
+
+#if PROCESS_EVENT_OVERFLOW
+  /* Once events have overflowed, new events must queue up behind
+     them to keep the events in order. */
+  if(nevents == PROCESS_CONF_NUMEVENTS || overflow_head != NULL) {
+    struct overflow_event *o = memb_alloc(&overflow_memb);
+    if(o != NULL) {
+      o->next = NULL;
+      o->e.ev = ev;
+      o->e.data = data;
+      o->e.p = p;
+#if PROCESS_TIMING
+      o->e.posted = RTIMER_NOW();
+#endif /* PROCESS_TIMING */
+      if(overflow_tail == NULL) {
+	overflow_head = o;
+      } else {
+	overflow_tail->next = o;
+      }
+      overflow_tail = o;
+      ++overflow_nevents;
+#if PROCESS_EVENT_STATS
+      queue_overflowed++;
+#endif /* PROCESS_EVENT_STATS */
+      return event_posted(p);
+    }
+  }
+#endif /* PROCESS_EVENT_OVERFLOW */
+
   if(nevents == PROCESS_CONF_NUMEVENTS) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
@@ -340,6 +687,12 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
       printf("soft panic: event queue is full when event %d was posted to %s frpm %s\n", ev, PROCESS_NAME_STRING(p), PROCESS_NAME_STRING(process_current));
     }
 #endif /* DEBUG */
+#if PROCESS_EVENT_STATS
+    queue_dropped++;
+    if(p != PROCESS_BROADCAST) {
+      p->evstats.dropped++;
+    }
+#endif /* PROCESS_EVENT_STATS */
     return PROCESS_ERR_FULL;
   }
   
@@ -347,6 +700,9 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
+#if PROCESS_TIMING
+  events[snum].posted = RTIMER_NOW();
+#endif /* PROCESS_TIMING */
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -354,8 +710,8 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     process_maxevents = nevents;
   }
 #endif /* PROCESS_CONF_STATS */
-  
-  return PROCESS_ERR_OK;
+
+  return event_posted(p);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -373,8 +729,20 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_PRIORITIES
+      if(!p->needspoll) {
+	p->pollnext = NULL;
+	if(poll_tail[p->priority] == NULL) {
+	  poll_head[p->priority] = p;
+	} else {
+	  poll_tail[p->priority]->pollnext = p;
+	}
+	poll_tail[p->priority] = p;
+      }
+#endif /* PROCESS_PRIORITIES */
       p->needspoll = 1;
       poll_requested = 1;
+      PROCESS_POLL_HOOK();
     }
   }
 }
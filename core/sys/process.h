@@ -88,6 +88,83 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * PROCESS_CONF_PRIORITIES enables two priority levels for
+ * processes. Polls of, and events posted to, high priority processes
+ * are handled before those of normal priority processes. High
+ * priority events are kept in a separate queue of
+ * PROCESS_CONF_NUMEVENTS_HIGH events, and polled processes are kept
+ * in queues instead of being found by scanning the process list.
+ *
+ * The poll queues are not safe against interrupts, so with
+ * PROCESS_CONF_PRIORITIES enabled process_poll() must not be called
+ * from an interrupt handler that may run while the scheduler
+ * manipulates the queues.
+ */
+#ifdef PROCESS_CONF_PRIORITIES
+#define PROCESS_PRIORITIES PROCESS_CONF_PRIORITIES
+#else /* PROCESS_CONF_PRIORITIES */
+#define PROCESS_PRIORITIES 0
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/*
+ * PROCESS_CONF_EVENTS_PER_RUN is the maximum number of events that
+ * process_run() delivers before returning. Pending polls are handled
+ * before each event.
+ */
+#ifndef PROCESS_CONF_EVENTS_PER_RUN
+#define PROCESS_CONF_EVENTS_PER_RUN 1
+#endif /* PROCESS_CONF_EVENTS_PER_RUN */
+
+#define PROCESS_PRIORITY_NORMAL 0
+#define PROCESS_PRIORITY_HIGH   1
+
+/*
+ * PROCESS_CONF_EVENT_OVERFLOW is the number of extra events, taken
+ * from a memb pool, that can be queued once the
+ * PROCESS_CONF_NUMEVENTS entries of the event queue are used up. The
+ * pool is not used unless the queue is full. Zero disables the pool.
+ */
+#ifdef PROCESS_CONF_EVENT_OVERFLOW
+#define PROCESS_EVENT_OVERFLOW PROCESS_CONF_EVENT_OVERFLOW
+#else /* PROCESS_CONF_EVENT_OVERFLOW */
+#define PROCESS_EVENT_OVERFLOW 0
+#endif /* PROCESS_CONF_EVENT_OVERFLOW */
+
+/*
+ * PROCESS_CONF_EVENT_STATS enables counters of posted, delivered and
+ * dropped events for each process, and statistics for the event
+ * queue. process_event_queue_congested() reports when the number of
+ * queued events reaches PROCESS_CONF_EVENT_HIGH_WATER.
+ */
+#ifdef PROCESS_CONF_EVENT_STATS
+#define PROCESS_EVENT_STATS PROCESS_CONF_EVENT_STATS
+#else /* PROCESS_CONF_EVENT_STATS */
+#define PROCESS_EVENT_STATS 0
+#endif /* PROCESS_CONF_EVENT_STATS */
+
+/*
+ * PROCESS_CONF_TIMING makes the scheduler measure, in rtimer ticks,
+ * how long each process runs and how long events wait in the queue
+ * before they are delivered.
+ */
+#ifdef PROCESS_CONF_TIMING
+#define PROCESS_TIMING PROCESS_CONF_TIMING
+#else /* PROCESS_CONF_TIMING */
+#define PROCESS_TIMING 0
+#endif /* PROCESS_CONF_TIMING */
+
+#ifdef PROCESS_CONF_EVENT_HIGH_WATER
+#define PROCESS_EVENT_HIGH_WATER PROCESS_CONF_EVENT_HIGH_WATER
+#else /* PROCESS_CONF_EVENT_HIGH_WATER */
+#define PROCESS_EVENT_HIGH_WATER                                \
+  ((PROCESS_CONF_NUMEVENTS + PROCESS_EVENT_OVERFLOW) * 3 / 4)
+#endif /* PROCESS_CONF_EVENT_HIGH_WATER */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -312,6 +389,65 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
 
 /** @} */
 
+#if PROCESS_EVENT_STATS
+/**
+ * Event counters for a process. Only events posted with
+ * process_post() to the process itself are counted; broadcast events
+ * are only counted in the event queue statistics.
+ */
+struct process_event_stats {
+  /** Events that were put in the event queue. */
+  unsigned short posted;
+  /** Events that were taken from the queue and given to the process. */
+  unsigned short delivered;
+  /** Events that could not be posted because the queue was full. */
+  unsigned short dropped;
+};
+
+/**
+ * Statistics for the event queue.
+ */
+struct process_queue_stats {
+  /** The number of events that fit in the queue, including the
+      overflow pool. */
+  unsigned short size;
+  /** The number of events currently in the queue. */
+  unsigned short queued;
+  /** The largest number of events that have been in the queue. */
+  unsigned short max;
+  /** The number of events that have been taken from the overflow
+      pool. */
+  unsigned short overflowed;
+  /** The number of events, broadcast events included, that could not
+      be posted because the queue was full. */
+  unsigned short dropped;
+};
+#endif /* PROCESS_EVENT_STATS */
+
+#if PROCESS_TIMING
+/**
+ * Run time and event latency of a process, in rtimer ticks. The run
+ * time of a process does not include the time spent in other
+ * processes that it calls synchronously. Each measurement must be
+ * shorter than the wrap-around time of the rtimer clock.
+ */
+struct process_timing {
+  /** The number of times the process has been called. */
+  unsigned long calls;
+  /** The total time the process has been running. */
+  unsigned long time;
+  /** The longest time the process has run in one call. */
+  unsigned long max_time;
+  /** The number of queued events that have been delivered to the
+      process. Broadcast events are not included. */
+  unsigned long events;
+  /** The total time the delivered events spent in the queue. */
+  unsigned long latency;
+  /** The longest time an event spent in the queue. */
+  unsigned long max_latency;
+};
+#endif /* PROCESS_TIMING */
+
 struct process {
   struct process *next;
 #if PROCESS_CONF_NO_PROCESS_NAMES
@@ -323,6 +459,16 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_PRIORITIES
+  unsigned char priority;
+  struct process *pollnext;
+#endif /* PROCESS_PRIORITIES */
+#if PROCESS_EVENT_STATS
+  struct process_event_stats evstats;
+#endif /* PROCESS_EVENT_STATS */
+#if PROCESS_TIMING
+  struct process_timing timing;
+#endif /* PROCESS_TIMING */
 };
 
 /**
@@ -452,6 +598,23 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+#if PROCESS_PRIORITIES
+/**
+ * \brief      Set the priority of a process.
+ * \param p    The process
+ * \param priority PROCESS_PRIORITY_NORMAL or PROCESS_PRIORITY_HIGH
+ *
+ *             Processes have normal priority by default. Polls of and
+ *             events to high priority processes are handled before
+ *             those of normal priority processes. Only available with
+ *             PROCESS_CONF_PRIORITIES.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+#define PROCESS_SET_PRIORITY(p, priority) process_set_priority(p, priority)
+#else /* PROCESS_PRIORITIES */
+#define PROCESS_SET_PRIORITY(p, priority)
+#endif /* PROCESS_PRIORITIES */
+
 /** @} */
 
 /**
@@ -489,7 +652,8 @@ void process_init(void);
  *
  * This function should be called repeatedly from the main() program
  * to actually run the Contiki system. It calls the necessary poll
- * handlers, and processes one event. The function returns the number
+ * handlers, and processes one event, or up to
+ * PROCESS_CONF_EVENTS_PER_RUN events. The function returns the number
  * of events that are waiting in the event queue so that the caller
  * may choose to put the CPU to sleep when there are no pending
  * events.
@@ -519,6 +683,65 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_EVENT_STATS
+/**
+ * \brief      Get the event counters of a process.
+ * \param p    The process
+ * \return     A pointer to the event counters of the process.
+ *
+ *             The counters are cleared when the process is started
+ *             and wrap around when they overflow.
+ */
+const struct process_event_stats *process_get_event_stats(struct process *p);
+
+/**
+ * \brief      Get statistics for the event queue.
+ * \param stats A pointer to a structure that is filled in.
+ */
+void process_get_queue_stats(struct process_queue_stats *stats);
+
+/**
+ * \brief      Reset the maximum and counters of the event queue
+ *             statistics.
+ */
+void process_reset_queue_stats(void);
+
+/**
+ * \brief      Check if the event queue is filling up.
+ * \return     Non-zero if PROCESS_CONF_EVENT_HIGH_WATER or more
+ *             events are queued.
+ *
+ *             This function can be used by processes that post many
+ *             events to back off before the queue becomes full and
+ *             events are dropped.
+ */
+int process_event_queue_congested(void);
+#endif /* PROCESS_EVENT_STATS */
+
+#if PROCESS_TIMING
+/**
+ * \brief      Get the run time and event latency of a process.
+ * \param p    The process
+ * \return     A pointer to the timing of the process.
+ *
+ *             Together with PROCESS_LIST(), this can be used to
+ *             find the processes that use the most time:
+ *
+ \code
+ for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+   const struct process_timing *t = process_get_timing(p);
+   ...
+ }
+ \endcode
+ */
+const struct process_timing *process_get_timing(struct process *p);
+
+/**
+ * \brief      Clear the run time and event latency of all processes.
+ */
+void process_reset_timing(void);
+#endif /* PROCESS_TIMING */
+
 /** @} */
 
 CCIF extern struct process *process_list;
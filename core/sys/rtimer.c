@@ -55,6 +55,7 @@
 #define PRINTF(...)
 #endif
 
+/* The scheduled tasks, ordered by time. */
 static struct rtimer *next_rtimer;
 
 /*---------------------------------------------------------------------------*/
@@ -64,26 +65,50 @@ rtimer_init(void)
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+static void
+remove_rtimer(struct rtimer *rtimer)
+{
+  struct rtimer **r;
+
+  for(r = &next_rtimer; *r != NULL; r = &(*r)->next) {
+    if(*r == rtimer) {
+      *r = rtimer->next;
+      if(r == &next_rtimer && next_rtimer != NULL) {
+        /* The head was removed, so the timer must be set for the new
+           head. */
+        rtimer_arch_schedule(next_rtimer->time);
+      }
+      break;
+    }
+  }
+  rtimer->next = NULL;
+}
+/*---------------------------------------------------------------------------*/
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
 	   rtimer_callback_t func, void *ptr)
 {
-  int first = 0;
+  struct rtimer **r;
 
   PRINTF("rtimer_set time %d\n", time);
 
-  if(next_rtimer == NULL) {
-    first = 1;
-  }
+  remove_rtimer(rtimer);
 
   rtimer->func = func;
   rtimer->ptr = ptr;
 
   rtimer->time = time;
-  next_rtimer = rtimer;
 
-  if(first == 1) {
+  /* Insert the task after all tasks that are due at the same time or
+     earlier. */
+  for(r = &next_rtimer;
+      *r != NULL && !RTIMER_CLOCK_LT(time, (*r)->time);
+      r = &(*r)->next);
+  rtimer->next = *r;
+  *r = rtimer;
+
+  if(r == &next_rtimer) {
     rtimer_arch_schedule(time);
   }
   return RTIMER_OK;
@@ -93,12 +118,22 @@ void
 rtimer_run_next(void)
 {
   struct rtimer *t;
+  rtimer_clock_t now;
+
   if(next_rtimer == NULL) {
     return;
   }
-  t = next_rtimer;
-  next_rtimer = NULL;
-  t->func(t, t->ptr);
+
+  /* Run the tasks that are due. The timer may have been set for a task
+     that has since been moved or removed, so the first task is checked
+     too. */
+  now = RTIMER_NOW();
+  while(next_rtimer != NULL && !RTIMER_CLOCK_LT(now, next_rtimer->time)) {
+    t = next_rtimer;
+    next_rtimer = t->next;
+    t->next = NULL;
+    t->func(t, t->ptr);
+  }
   if(next_rtimer != NULL) {
     rtimer_arch_schedule(next_rtimer->time);
   }
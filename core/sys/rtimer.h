@@ -84,6 +84,7 @@ struct rtimer {
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
+  struct rtimer *next;
 };
 
 enum {
@@ -104,7 +105,10 @@ enum {
  *             (false) if the task could not be scheduled.
  *
  *             This function schedules a real-time task at a specified
- *             time in the future.
+ *             time in the future. Any number of tasks can be
+ *             scheduled at the same time; they are kept in a queue
+ *             ordered by time. Setting a task that already is
+ *             scheduled moves it to the new time.
  *
  */
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
@@ -115,6 +119,8 @@ int rtimer_set(struct rtimer *task, rtimer_clock_t time,
  *
  *             This function is called by the architecture dependent
  *             code to execute and schedule the next real-time task.
+ *             All tasks that are due when the function is called are
+ *             executed.
  *
  */
 void rtimer_run_next(void);
@@ -53,19 +53,65 @@ static void *main_fiber;
 #endif
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <signal.h>
 #include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* Unused stack is filled with this pattern, so that
+   mtarch_stack_usage() can find how deep the stack has grown. */
+#define STACK_PATTERN 0xa5
 
 struct mtarch_t {
-  char stack[MTARCH_STACKSIZE];
+  /* The mapping holds an inaccessible guard page below the stack, so
+     that a stack overflow causes a fault instead of silently
+     overwriting other memory. */
+  char *mapping;
+  size_t mapping_size;
+  char *stack;
+  size_t stack_size;
   ucontext_t context;
 };
 
 static ucontext_t main_context;
 static ucontext_t *running_context;
+static struct mtarch_t *running;
+
+#ifdef __linux
+/* The SIGSEGV handler runs on its own stack, since the stack of the
+   thread is exhausted when the guard page is hit. */
+static char signal_stack[16384];
+static struct sigaction old_segv_action;
+#endif /* __linux */
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 
+/*--------------------------------------------------------------------------*/
+#ifdef __linux
+static void
+segv_handler(int sig, siginfo_t *info, void *context)
+{
+  static const char msg[] = "mtarch: stack overflow in thread\n";
+  char *addr = info->si_addr;
+
+  if(running != NULL &&
+     addr >= running->mapping && addr < running->stack) {
+    if(write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0) {
+      /* Nothing more we can do. */
+    }
+    abort();
+  }
+
+  /* Not ours: let the fault happen again with the previous action. */
+  sigaction(SIGSEGV, &old_segv_action, NULL);
+}
+#endif /* __linux */
 /*--------------------------------------------------------------------------*/
 void
 mtarch_init(void)
@@ -74,7 +120,23 @@ mtarch_init(void)
 
   main_fiber = ConvertThreadToFiber(NULL);
 
-#endif /* _WIN32 || __CYGWIN__ */
+#elif defined(__linux)
+
+  stack_t ss;
+  struct sigaction sa;
+
+  ss.ss_sp = signal_stack;
+  ss.ss_size = sizeof(signal_stack);
+  ss.ss_flags = 0;
+  sigaltstack(&ss, NULL);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = segv_handler;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGSEGV, &sa, &old_segv_action);
+
+#endif /* _WIN32 || __CYGWIN__ || __linux */
 }
 /*--------------------------------------------------------------------------*/
 void
@@ -84,7 +146,11 @@ mtarch_remove(void)
 
   ConvertFiberToThread();
 
-#endif /* _WIN32 || __CYGWIN__ */
+#elif defined(__linux)
+
+  sigaction(SIGSEGV, &old_segv_action, NULL);
+
+#endif /* _WIN32 || __CYGWIN__ || __linux */
 }
 /*--------------------------------------------------------------------------*/
 void
@@ -98,15 +164,30 @@ mtarch_start(struct mtarch_thread *thread,
 
 #elif defined(__linux)
 
-  thread->mt_thread = malloc(sizeof(struct mtarch_t));
+  struct mtarch_t *t;
+  size_t page;
+
+  t = malloc(sizeof(struct mtarch_t));
+  thread->mt_thread = t;
 
-  getcontext(&((struct mtarch_t *)thread->mt_thread)->context);
+  page = sysconf(_SC_PAGESIZE);
+  t->stack_size = (MTARCH_STACKSIZE + page - 1) & ~(page - 1);
+  t->mapping_size = t->stack_size + page;
+  t->mapping = mmap(NULL, t->mapping_size, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(t->mapping == MAP_FAILED) {
+    perror("mtarch_start: mmap");
+    exit(1);
+  }
+  mprotect(t->mapping, page, PROT_NONE);
+  t->stack = t->mapping + page;
+  memset(t->stack, STACK_PATTERN, t->stack_size);
 
-  ((struct mtarch_t *)thread->mt_thread)->context.uc_link = NULL;
-  ((struct mtarch_t *)thread->mt_thread)->context.uc_stack.ss_sp = 
-			((struct mtarch_t *)thread->mt_thread)->stack;
-  ((struct mtarch_t *)thread->mt_thread)->context.uc_stack.ss_size = 
-			sizeof(((struct mtarch_t *)thread->mt_thread)->stack);
+  getcontext(&t->context);
+
+  t->context.uc_link = NULL;
+  t->context.uc_stack.ss_sp = t->stack;
+  t->context.uc_stack.ss_size = t->stack_size;
 
   /* Some notes:
      - If a CPU needs stronger alignment for the stack than malloc()
@@ -123,8 +204,7 @@ mtarch_start(struct mtarch_thread *thread,
        the only way to stay independent from the CPU architecture. But
        Solaris prior to release 10 interprets ss_sp as highest stack
        address thus requiring special handling. */
-  makecontext(&((struct mtarch_t *)thread->mt_thread)->context,
-	      (void (*)(void))function, 1, data);
+  makecontext(&t->context, (void (*)(void))function, 1, data);
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 }
@@ -152,9 +232,11 @@ mtarch_exec(struct mtarch_thread *thread)
 
 #elif defined(__linux)
 
-  running_context = &((struct mtarch_t *)thread->mt_thread)->context;
+  running = thread->mt_thread;
+  running_context = &running->context;
   swapcontext(&main_context, running_context);
   running_context = NULL;
+  running = NULL;
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 }
@@ -168,6 +250,8 @@ mtarch_stop(struct mtarch_thread *thread)
 
 #elif defined(linux) || defined(__linux)
 
+  munmap(((struct mtarch_t *)thread->mt_thread)->mapping,
+	 ((struct mtarch_t *)thread->mt_thread)->mapping_size);
   free(thread->mt_thread);
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
@@ -183,3 +267,27 @@ mtarch_pstop(void)
 {
 }
 /*--------------------------------------------------------------------------*/
+int
+mtarch_stack_usage(struct mt_thread *t)
+{
+#if defined(__linux)
+
+  struct mtarch_t *m = t->thread.mt_thread;
+  size_t i;
+
+  /* The stack grows downwards, so the lowest byte that no longer
+     holds the pattern marks the deepest point reached. */
+  for(i = 0; i < m->stack_size; ++i) {
+    if((unsigned char)m->stack[i] != STACK_PATTERN) {
+      return m->stack_size - i;
+    }
+  }
+  return 0;
+
+#else /* __linux */
+
+  return -1;
+
+#endif /* __linux */
+}
+/*--------------------------------------------------------------------------*/
@@ -39,4 +39,15 @@ struct mtarch_thread {
   void *mt_thread;
 };
 
+struct mt_thread;
+
+/**
+ * Get the deepest stack usage of a thread, in bytes.
+ *
+ * Thread stacks are allocated with an inaccessible guard page below
+ * them, so a thread that overflows its stack is stopped with an
+ * error message. Returns -1 where this is not supported.
+ */
+int mtarch_stack_usage(struct mt_thread *t);
+
 #endif /* __MTARCH_H__ */
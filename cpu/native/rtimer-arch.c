@@ -46,6 +46,14 @@
 #include "sys/rtimer.h"
 #include "sys/clock.h"
 
+#if RTIMER_ARCH_TIMERFD
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#endif /* RTIMER_ARCH_TIMERFD */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -54,6 +62,10 @@
 #define PRINTF(...)
 #endif
 
+#if RTIMER_ARCH_TIMERFD
+static int timerfd = -1;
+static struct native_fd timerfd_nfd;
+#endif /* RTIMER_ARCH_TIMERFD */
 /*---------------------------------------------------------------------------*/
 static void
 interrupt(int sig)
@@ -62,9 +74,45 @@ interrupt(int sig)
   rtimer_run_next();
 }
 /*---------------------------------------------------------------------------*/
+#if RTIMER_ARCH_TIMERFD
+static void
+timerfd_handler(struct native_fd *nfd, int events)
+{
+  uint64_t expirations;
+
+  if(read(timerfd, &expirations, sizeof(expirations)) > 0) {
+    rtimer_run_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (rtimer_clock_t)(ts.tv_sec * 1000000ul + ts.tv_nsec / 1000);
+}
+#endif /* RTIMER_ARCH_TIMERFD */
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_init(void)
 {
+#if RTIMER_ARCH_TIMERFD
+  /* Real-time tasks are run from the main loop when the timer file
+     descriptor becomes readable, rather than from a signal handler. */
+  timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(timerfd >= 0 &&
+     native_fd_add(&timerfd_nfd, timerfd, NATIVE_FD_READ, timerfd_handler,
+                   NULL)) {
+    return;
+  }
+  perror("rtimer-arch: timerfd");
+  if(timerfd >= 0) {
+    close(timerfd);
+    timerfd = -1;
+  }
+#endif /* RTIMER_ARCH_TIMERFD */
 #ifndef _WIN32
   signal(SIGALRM, interrupt);
 #endif /* !_WIN32 */
@@ -75,15 +123,39 @@ rtimer_arch_schedule(rtimer_clock_t t)
 {
 #ifndef _WIN32
   struct itimerval val;
-  rtimer_clock_t c;
+  rtimer_clock_t now, c;
+
+  now = rtimer_arch_now();
+  c = t - now;
+  if(!RTIMER_CLOCK_LT(now, t)) {
+    /* A zero timeout disarms the timer, so make sure that a task that
+       is due already runs as soon as possible. */
+    c = 1;
+  }
+
+#if RTIMER_ARCH_TIMERFD
+  if(timerfd >= 0) {
+    struct itimerspec its;
+
+    its.it_value.tv_sec = c / RTIMER_ARCH_SECOND;
+    its.it_value.tv_nsec = (c % RTIMER_ARCH_SECOND) *
+      (1000000000ul / RTIMER_ARCH_SECOND);
+    its.it_interval.tv_sec = its.it_interval.tv_nsec = 0;
+
+    PRINTF("rtimer_arch_schedule time %lu in %lu us\n",
+           (unsigned long)t, (unsigned long)c);
+
+    timerfd_settime(timerfd, 0, &its, NULL);
+    return;
+  }
+#endif /* RTIMER_ARCH_TIMERFD */
 
-  c = t - (unsigned short)clock_time();
-  
-  val.it_value.tv_sec = c / 1000;
-  val.it_value.tv_usec = (c % 1000) * 1000;
+  val.it_value.tv_sec = c / RTIMER_ARCH_SECOND;
+  val.it_value.tv_usec = (c % RTIMER_ARCH_SECOND) *
+    (1000000ul / RTIMER_ARCH_SECOND);
 
-  PRINTF("rtimer_arch_schedule time %u %u in %d.%d seconds\n", t, c, c / 1000,
-	 (c % 1000) * 1000);
+  PRINTF("rtimer_arch_schedule time %lu in %lu ticks\n",
+         (unsigned long)t, (unsigned long)c);
 
   val.it_interval.tv_sec = val.it_interval.tv_usec = 0;
   setitimer(ITIMER_REAL, &val, NULL);
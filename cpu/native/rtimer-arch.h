@@ -42,8 +42,25 @@
 
 #include "contiki-conf.h"
 
+/* With RTIMER_ARCH_CONF_TIMERFD set, real-time tasks are driven by a
+   Linux timerfd on the monotonic clock with microsecond resolution,
+   and run from the main loop of the platform. Otherwise they are
+   driven by SIGALRM with the resolution of the system clock. The
+   timerfd backend needs an rtimer_clock_t of at least 32 bits. */
+#ifdef RTIMER_ARCH_CONF_TIMERFD
+#define RTIMER_ARCH_TIMERFD RTIMER_ARCH_CONF_TIMERFD
+#else /* RTIMER_ARCH_CONF_TIMERFD */
+#define RTIMER_ARCH_TIMERFD 0
+#endif /* RTIMER_ARCH_CONF_TIMERFD */
+
+#if RTIMER_ARCH_TIMERFD
+#define RTIMER_ARCH_SECOND 1000000ul
+
+rtimer_clock_t rtimer_arch_now(void);
+#else /* RTIMER_ARCH_TIMERFD */
 #define RTIMER_ARCH_SECOND CLOCK_CONF_SECOND
 
 #define rtimer_arch_now() clock_time()
+#endif /* RTIMER_ARCH_TIMERFD */
 
 #endif /* __RTIMER_ARCH_H__ */
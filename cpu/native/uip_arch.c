@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checksum functions of uIP for native hosts, enabled with
+ *         UIP_ARCH_CHKSUM. Words are summed 32 bits at a time into a
+ *         64-bit accumulator instead of 16 bits at a time with
+ *         explicit carry handling.
+ */
+
+#include <string.h>
+
+#include "net/uip.h"
+#include "net/uip_arch.h"
+
+#if UIP_ARCH_CHKSUM
+
+#define BUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/*---------------------------------------------------------------------------*/
+/*
+ * The one's complement sum does not depend on the byte order of the
+ * words (RFC 1071), so the data is summed in host byte order, with
+ * the carries collected in the upper half of the accumulator, and the
+ * folded sum is swapped to network byte order at the end. The sum is
+ * taken and returned in host byte order, so that it can be continued
+ * over several calls.
+ */
+static uint16_t
+chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc, a, b, c, d;
+  uint32_t w32;
+  uint16_t w16;
+
+  acc = uip_htons(sum);
+
+  while(len >= 32) {
+    memcpy(&a, data, 8);
+    memcpy(&b, data + 8, 8);
+    memcpy(&c, data + 16, 8);
+    memcpy(&d, data + 24, 8);
+    acc += (a & 0xffffffff) + (a >> 32) + (b & 0xffffffff) + (b >> 32) +
+      (c & 0xffffffff) + (c >> 32) + (d & 0xffffffff) + (d >> 32);
+    data += 32;
+    len -= 32;
+  }
+  while(len >= 4) {
+    memcpy(&w32, data, 4);
+    acc += w32;
+    data += 4;
+    len -= 4;
+  }
+  if(len >= 2) {
+    memcpy(&w16, data, 2);
+    acc += w16;
+    data += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    /* The last byte is padded with a zero byte after it. */
+    w16 = 0;
+    memcpy(&w16, data, 1);
+    acc += w16;
+  }
+
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  /* Return sum in host byte order. */
+  return uip_ntohs((uint16_t)acc);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum(uint16_t *data, uint16_t len)
+{
+  return uip_htons(chksum(0, (uint8_t *)data, len));
+}
+/*---------------------------------------------------------------------------*/
+#ifndef UIP_ARCH_IPCHKSUM
+uint16_t
+uip_ipchksum(void)
+{
+  uint16_t sum;
+
+  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+#endif
+/*---------------------------------------------------------------------------*/
+static uint16_t
+upper_layer_chksum(uint8_t proto)
+{
+  uint16_t upper_layer_len;
+  uint16_t hdr_len;
+  uint16_t sum;
+
+#if UIP_CONF_IPV6
+  upper_layer_len = (((uint16_t)(BUF->len[0]) << 8) + BUF->len[1]) - uip_ext_len;
+  hdr_len = UIP_IPH_LEN + uip_ext_len;
+#else /* UIP_CONF_IPV6 */
+  upper_layer_len = (((uint16_t)(BUF->len[0]) << 8) + BUF->len[1]) - UIP_IPH_LEN;
+  hdr_len = UIP_IPH_LEN;
+#endif /* UIP_CONF_IPV6 */
+
+  /* First sum pseudoheader. */
+  /* IP protocol and length fields. This addition cannot carry. */
+  sum = upper_layer_len + proto;
+  /* Sum IP source and destination addresses. */
+  sum = chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+
+  /* Sum upper layer header and data. */
+  sum = chksum(sum, &uip_buf[UIP_LLH_LEN + hdr_len], upper_layer_len);
+
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_CONF_IPV6
+uint16_t
+uip_icmp6chksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_ICMP6);
+}
+#endif /* UIP_CONF_IPV6 */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+uint16_t
+uip_tcpchksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_TCP);
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP && UIP_UDP_CHECKSUMS
+uint16_t
+uip_udpchksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_UDP);
+}
+#endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_ARCH_CHKSUM */
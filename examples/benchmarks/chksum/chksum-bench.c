@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks the uIP checksum functions of the platform against
+ *         the portable implementation in uip6.c with random data, and
+ *         compares their speed. On native, the platform functions are
+ *         those of cpu/native/uip_arch.c unless UIP_ARCH_CHKSUM is 0.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define FUZZ_ROUNDS   200000L
+#define PACKET_ROUNDS 100000L
+
+static uint8_t buf[65536 + 8];
+static long failures;
+
+PROCESS(chksum_bench_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_bench_process);
+/*---------------------------------------------------------------------------*/
+/* A copy of chksum() in uip6.c. */
+static uint16_t
+reference_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {   /* At least two more bytes */
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+  }
+
+  /* Return sum in host byte order. */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+/* A copy of upper_layer_chksum() in uip6.c. */
+static uint16_t
+reference_upper_layer_chksum(uint8_t proto)
+{
+  uint16_t upper_layer_len;
+  uint16_t sum;
+
+  upper_layer_len = (((uint16_t)(UIP_IP_BUF->len[0]) << 8) +
+                     UIP_IP_BUF->len[1] - uip_ext_len);
+  sum = upper_layer_len + proto;
+  sum = reference_chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr,
+                         2 * sizeof(uip_ipaddr_t));
+  sum = reference_chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+                         upper_layer_len);
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(uint8_t *p, int len)
+{
+  int i, mode;
+
+  /* All-ones and all-zeros data exercise the carries and the
+     0 / 0xffff corner of one's complement arithmetic. */
+  mode = rand() % 4;
+  for(i = 0; i < len; i++) {
+    p[i] = mode == 0 ? 0xff : mode == 1 ? 0 : rand();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fuzz_chksum(void)
+{
+  long i;
+  int offset, len;
+  uint16_t expected;
+
+  for(i = 0; i < FUZZ_ROUNDS; i++) {
+    /* Every alignment, mostly frame sized, sometimes up to 64 KiB. */
+    offset = rand() % 8;
+    len = (i % 100 == 0) ? rand() % 65536 : rand() % 1500;
+    fill(&buf[offset], len);
+    expected = uip_htons(reference_chksum(0, &buf[offset], len));
+    if(uip_chksum((uint16_t *)&buf[offset], len) != expected) {
+      if(failures++ < 10) {
+        printf("FAIL: uip_chksum, offset %d length %d\n", offset, len);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fuzz_upper_layer(void)
+{
+  long i;
+  int len;
+
+  uip_ext_len = 0;
+  for(i = 0; i < PACKET_ROUNDS; i++) {
+    len = rand() % (UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPH_LEN + 1);
+    fill(&uip_buf[UIP_LLH_LEN], UIP_IPH_LEN + len);
+    UIP_IP_BUF->len[0] = len >> 8;
+    UIP_IP_BUF->len[1] = len & 0xff;
+    if(uip_icmp6chksum() != reference_upper_layer_chksum(UIP_PROTO_ICMP6)) {
+      if(failures++ < 10) {
+        printf("FAIL: uip_icmp6chksum, length %d\n", len);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(int len)
+{
+  static volatile uint16_t result;
+  long i, rounds;
+  double t, reference;
+
+  rounds = 50000000L / len;
+
+  t = now();
+  for(i = 0; i < rounds; i++) {
+    result += reference_chksum(i, &buf[1], len);
+  }
+  reference = now() - t;
+
+  t = now();
+  for(i = 0; i < rounds; i++) {
+    result += uip_chksum((uint16_t *)&buf[1], len);
+  }
+  t = now() - t;
+
+  printf("%4d bytes: uip6.c %6.1f ns, uip_chksum %6.1f ns\n",
+         len, reference / rounds * 1e9, t / rounds * 1e9);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  srand(1);
+  fuzz_chksum();
+  fuzz_upper_layer();
+  printf("UIP_ARCH_CHKSUM %d: %ld mismatches\n", UIP_ARCH_CHKSUM, failures);
+
+  bench(40);
+  bench(100);
+  bench(576);
+  bench(1280);
+
+  printf("%s\n", failures == 0 ? "OK" : "FAILED");
+  exit(failures == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Throughput and control latency of the CSMA queues with many
+ *         flows, on the native platform. Packets go straight to the
+ *         MAC layer and through nullrdc to a radio driver that blocks
+ *         for the airtime of each frame. The flows are:
+ *
+ *         - a bulk flow to neighbor 1 that keeps as many packets
+ *           queued as CSMA accepts,
+ *         - a small flow to each of the other neighbors, 4 packets/s,
+ *         - control packets (PACKETBUF_ATTR_MAC_PRIORITY) at 10/s,
+ *           to each neighbor in turn.
+ *
+ *         At the end, the program prints the bytes per second of the
+ *         flows, the dropped packets and the latency of the control
+ *         packets.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/mac/csma.h"
+#include "dev/radio.h"
+#include "lib/memb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef CSMA_BENCH_SECONDS
+#define CSMA_BENCH_SECONDS 10
+#endif
+#ifndef CSMA_BENCH_AIRTIME_MS
+#define CSMA_BENCH_AIRTIME_MS 4
+#endif
+
+#define NEIGHBORS   8
+#define BULK_LEN    100
+#define SMALL_LEN   60
+#define CONTROL_LEN 40
+
+struct flow {
+  unsigned long sent_bytes;
+  unsigned long dropped;
+};
+
+/* Index 0 is the bulk flow, 1 to NEIGHBORS - 1 the small flows. */
+static struct flow flows[NEIGHBORS];
+static struct flow control;
+static unsigned long control_sent, control_latency, control_latency_max;
+static int bulk_queued;
+/* Set while a packet is handed to the MAC layer. A packet that CSMA
+   refuses is reported from inside NETSTACK_MAC.send(). */
+static uint8_t sending;
+
+/* Each packet handed to the MAC layer has a tag, given to the sent
+   callback. There are more tags than packet buffers in CSMA. */
+struct tag {
+  uint8_t neighbor;
+  uint8_t is_control;
+  clock_time_t queued;
+};
+#define TAGS 32
+MEMB(tag_memb, struct tag, TAGS);
+
+PROCESS(csma_bench_process, "CSMA benchmark");
+AUTOSTART_PROCESSES(&csma_bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+airtime_send(const void *payload, unsigned short payload_len)
+{
+  usleep(CSMA_BENCH_AIRTIME_MS * 1000);
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+airtime_prepare(const void *payload, unsigned short payload_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+airtime_transmit(unsigned short transmit_len)
+{
+  usleep(CSMA_BENCH_AIRTIME_MS * 1000);
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+airtime_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+airtime_zero(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+airtime_one(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver airtime_radio_driver = {
+  airtime_zero,
+  airtime_prepare,
+  airtime_transmit,
+  airtime_send,
+  airtime_read,
+  airtime_one,
+  airtime_zero,
+  airtime_zero,
+  airtime_one,
+  airtime_one,
+};
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  struct tag *t = ptr;
+  clock_time_t latency;
+
+  if(t->neighbor == 0 && !t->is_control) {
+    bulk_queued--;
+    if(!sending) {
+      process_poll(&csma_bench_process);
+    }
+  }
+  if(status != MAC_TX_OK) {
+    if(t->is_control) {
+      control.dropped++;
+    } else {
+      flows[t->neighbor].dropped++;
+    }
+  } else if(t->is_control) {
+    latency = clock_time() - t->queued;
+    control.sent_bytes += CONTROL_LEN;
+    control_sent++;
+    control_latency += latency;
+    if(latency > control_latency_max) {
+      control_latency_max = latency;
+    }
+  } else {
+    flows[t->neighbor].sent_bytes += t->neighbor == 0 ? BULK_LEN : SMALL_LEN;
+  }
+  memb_free(&tag_memb, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(int neighbor, int len, int is_control)
+{
+  struct tag *t;
+  rimeaddr_t addr;
+
+  t = memb_alloc(&tag_memb);
+  if(t == NULL) {
+    printf("out of tags\n");
+    exit(1);
+  }
+  t->neighbor = neighbor;
+  t->is_control = is_control;
+  t->queued = clock_time();
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = neighbor + 1;
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), 0, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+  if(is_control) {
+    packetbuf_set_attr(PACKETBUF_ATTR_MAC_PRIORITY, 1);
+  } else if(neighbor == 0) {
+    bulk_queued++;
+  }
+  sending = 1;
+  NETSTACK_MAC.send(packet_sent, t);
+  sending = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_bulk(void)
+{
+  unsigned long dropped;
+
+  /* Queue bulk packets until CSMA refuses one. A refused packet is
+     reported at once, so it is no longer counted as queued. */
+  while(bulk_queued < QUEUEBUF_NUM) {
+    dropped = flows[0].dropped;
+    send(0, BULK_LEN, 0);
+    if(flows[0].dropped != dropped) {
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(void)
+{
+  unsigned long total, small;
+  int i;
+
+  total = control.sent_bytes + flows[0].sent_bytes;
+  small = 0;
+  for(i = 1; i < NEIGHBORS; i++) {
+    small += flows[i].sent_bytes;
+  }
+  total += small;
+  printf("airtime %d ms, %d s: %lu B/s in total, bulk %lu B/s, small flows %lu B/s each\n",
+         CSMA_BENCH_AIRTIME_MS, CSMA_BENCH_SECONDS, total / CSMA_BENCH_SECONDS,
+         flows[0].sent_bytes / CSMA_BENCH_SECONDS,
+         small / CSMA_BENCH_SECONDS / (NEIGHBORS - 1));
+  small = 0;
+  for(i = 1; i < NEIGHBORS; i++) {
+    small += flows[i].dropped;
+  }
+  printf("dropped: bulk %lu, small flows %lu, control %lu\n",
+         flows[0].dropped, small, control.dropped);
+  printf("control: %lu sent, latency avg %lu ms max %lu ms\n",
+         control_sent,
+         control_sent ? control_latency * 1000 / CLOCK_SECOND / control_sent : 0,
+         control_latency_max * 1000 / CLOCK_SECOND);
+#if CSMA_STATS
+  {
+    struct csma_stats s;
+
+    csma_get_stats(&s);
+    printf("csma: queued %lu dropped %lu dequeued %lu, max queue %u, sojourn avg %lu max %lu ms\n",
+           s.queued, s.dropped, s.dequeued, s.max_queue_len,
+           s.dequeued ? s.sojourn_total * 1000 / CLOCK_SECOND / s.dequeued : 0,
+           (unsigned long)s.sojourn_max * 1000 / CLOCK_SECOND);
+  }
+#endif /* CSMA_STATS */
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(csma_bench_process, ev, data)
+{
+  static struct etimer small_timer, control_timer, end_timer;
+  static int next_control;
+  int i;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&small_timer, CLOCK_SECOND / 4);
+  etimer_set(&control_timer, CLOCK_SECOND / 10);
+  etimer_set(&end_timer, CSMA_BENCH_SECONDS * CLOCK_SECOND);
+  fill_bulk();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == PROCESS_EVENT_POLL) {
+      fill_bulk();
+    } else if(data == &small_timer) {
+      for(i = 1; i < NEIGHBORS; i++) {
+        send(i, SMALL_LEN, 0);
+      }
+      etimer_reset(&small_timer);
+    } else if(data == &control_timer) {
+      send(next_control, CONTROL_LEN, 1);
+      next_control = (next_control + 1) % NEIGHBORS;
+      etimer_reset(&control_timer);
+    } else if(data == &end_timer) {
+      break;
+    }
+  }
+
+  report();
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
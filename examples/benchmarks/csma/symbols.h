@@ -0,0 +1,3 @@
+#include "loader/symbols.h"
+
+extern const struct symbols symbols[1];
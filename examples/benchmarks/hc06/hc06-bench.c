@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Replays a corpus of IPv6 headers through the HC06 header
+ *         compression of sicslowpan in both directions. Each header
+ *         is compressed, uncompressed again and compared with the
+ *         original. The program reports the time per header in each
+ *         direction, the compression ratio and a hash over the
+ *         compressed bytes, which should stay the same when the
+ *         compression code is optimized.
+ *
+ *         The compression functions are static, so sicslowpan.c is
+ *         included here. Build with DEFINES=HC06_BENCH_CONTEXTS=<n>
+ *         to use n address contexts instead of the platform default.
+ */
+
+#include "contiki.h"
+
+#ifdef HC06_BENCH_CONTEXTS
+#undef SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS
+#define SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS HC06_BENCH_CONTEXTS
+#endif /* HC06_BENCH_CONTEXTS */
+
+#include "net/sicslowpan.c"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Number of times each header is compressed and uncompressed. */
+#define ROUNDS 200000L
+
+/* Size of the IPv6 and UDP headers compared after the round trip. */
+#define HDR_LEN (UIP_IPH_LEN + UIP_UDPH_LEN)
+
+struct header {
+  const char *src;
+  const char *dest;
+  uint8_t proto;
+  uint8_t ttl;
+  uint16_t srcport;
+  uint16_t destport;
+};
+
+/* Header shapes captured from the native border router and RPL
+   nodes: link-local unicast and multicast, DAD with the unspecified
+   source, context-based and inline global addresses, and UDP ports
+   in each of the compressible ranges. */
+static const struct header corpus[] = {
+  { "fe80::302:304:506:708", "fe80::302:304:506:709", UIP_PROTO_UDP, 64, 0xf0b1, 0xf0b2 },
+  { "fe80::302:304:506:708", "ff02::1", UIP_PROTO_ICMP6, 255, 0, 0 },
+  { "fe80::302:304:506:708", "ff02::1a", UIP_PROTO_ICMP6, 255, 0, 0 },
+  { "::", "ff02::1:ff06:708", UIP_PROTO_ICMP6, 255, 0, 0 },
+  { "aaaa::302:304:506:708", "aaaa::302:304:506:709", UIP_PROTO_UDP, 64, 5683, 5683 },
+  { "aaaa::302:304:506:708", "aaaa::ff:fe00:12", UIP_PROTO_UDP, 63, 0xf0b1, 1234 },
+  { "bbbb::1", "aaaa::302:304:506:709", UIP_PROTO_UDP, 30, 80, 0xf0b4 },
+  { "2001:db8::1", "2001:db8:1::2", UIP_PROTO_TCP, 64, 0, 0 },
+  { "fe80::1", "ff05::fb", UIP_PROTO_UDP, 1, 5353, 5353 },
+  { "cccc::302:304:506:708", "bbbb::1", UIP_PROTO_UDP, 64, 0xf0b1, 0xf0bf },
+};
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+static uint8_t frame[PACKETBUF_SIZE];
+static uint8_t decompressed[UIP_BUFSIZE];
+
+PROCESS(hc06_bench_process, "HC06 benchmark");
+AUTOSTART_PROCESSES(&hc06_bench_process);
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_header(const struct header *h)
+{
+  memset(uip_buf, 0, UIP_LLH_LEN + HDR_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = h->proto;
+  UIP_IP_BUF->ttl = h->ttl;
+  UIP_IP_BUF->len[1] = UIP_UDPH_LEN + 16;
+  inet_pton(AF_INET6, h->src, &UIP_IP_BUF->srcipaddr);
+  inet_pton(AF_INET6, h->dest, &UIP_IP_BUF->destipaddr);
+  if(h->proto == UIP_PROTO_UDP) {
+    UIP_UDP_BUF->srcport = UIP_HTONS(h->srcport);
+    UIP_UDP_BUF->destport = UIP_HTONS(h->destport);
+    UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + 16);
+    UIP_UDP_BUF->udpchksum = UIP_HTONS(0x1234);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup_contexts(void)
+{
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1
+  int i;
+
+  /* Context 0 is aaaa::/64 from sicslowpan_init(). Fill the others
+     with prefixes that do not match the corpus, except for the last
+     one, so that a lookup has to go through all of them. */
+  for(i = 1; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+    addr_contexts[i].used = 1;
+    addr_contexts[i].number = i;
+    memset(addr_contexts[i].prefix, 0, sizeof(addr_contexts[i].prefix));
+    addr_contexts[i].prefix[0] = 0x20;
+    addr_contexts[i].prefix[1] = 0x02;
+    addr_contexts[i].prefix[7] = i;
+  }
+  addr_contexts[i - 1].prefix[0] = 0xbb;
+  addr_contexts[i - 1].prefix[1] = 0xbb;
+  addr_contexts[i - 1].prefix[7] = 0;
+#if ADDR_CONTEXT_INDEX
+  addr_context_index_init();
+#endif /* ADDR_CONTEXT_INDEX */
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(hc06_bench_process, ev, data)
+{
+  static rimeaddr_t src, dest = {{ 3, 2, 3, 4, 5, 6, 7, 9 }};
+  unsigned k;
+  long i;
+  int failures, compressed, original;
+  uint32_t hash;
+  double t, compress_time, uncompress_time;
+
+  PROCESS_BEGIN();
+
+  setup_contexts();
+  rimeaddr_copy(&src, (rimeaddr_t *)&uip_lladdr);
+
+  failures = compressed = original = 0;
+  hash = 2166136261UL;
+  compress_time = uncompress_time = 0;
+
+  for(k = 0; k < CORPUS_SIZE; k++) {
+    build_header(&corpus[k]);
+    packetbuf_clear();
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &src);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+    rime_ptr = frame;
+
+    t = now();
+    for(i = 0; i < ROUNDS; i++) {
+      rime_hdr_len = 0;
+      compress_hdr_hc06(&dest);
+    }
+    compress_time += now() - t;
+    compressed += rime_hdr_len;
+    original += uncomp_hdr_len;
+    for(i = 0; i < rime_hdr_len; i++) {
+      hash = (hash ^ frame[i]) * 16777619UL;
+    }
+
+    sicslowpan_buf = decompressed;
+    memset(decompressed, 0, sizeof(decompressed));
+    t = now();
+    for(i = 0; i < ROUNDS; i++) {
+      rime_hdr_len = 0;
+      uncomp_hdr_len = 0;
+      uncompress_hdr_hc06(0);
+    }
+    uncompress_time += now() - t;
+
+    /* The payload length is not carried in the compressed header, so
+       it is left out of the comparison. */
+    if(memcmp(decompressed, uip_buf, UIP_LLH_LEN + 4) != 0 ||
+       memcmp(decompressed + UIP_LLH_LEN + 6, uip_buf + UIP_LLH_LEN + 6,
+              UIP_IPH_LEN + 4 - 6) != 0) {
+      printf("FAIL: %s -> %s does not round-trip\n",
+             corpus[k].src, corpus[k].dest);
+      failures++;
+    }
+  }
+
+  printf("%d contexts: compress %.1f ns/header, uncompress %.1f ns/header\n",
+         SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS,
+         compress_time / ROUNDS / CORPUS_SIZE * 1e9,
+         uncompress_time / ROUNDS / CORPUS_SIZE * 1e9);
+  printf("%d -> %d bytes (%.1f%%), hash %08lx\n",
+         original, compressed, 100.0 * compressed / original,
+         (unsigned long)hash);
+
+  printf("%s\n", failures == 0 ? "OK" : "FAILED");
+  exit(failures == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Microbenchmark of memb_alloc() and memb_free() on the native
+ *         platform, for pools of 8 to 4096 blocks. Each round allocates
+ *         the whole pool and frees it again in a scattered order.
+ *
+ *         Build with DEFINES=MEMB_CONF_FREELIST=0 to compare with the
+ *         allocator that scans the pool.
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Number of alloc/free pairs timed for each pool. */
+#define OPERATIONS 4000000L
+
+struct block {
+  int data[4];
+};
+
+MEMB(pool8, struct block, 8);
+MEMB(pool64, struct block, 64);
+MEMB(pool512, struct block, 512);
+MEMB(pool4096, struct block, 4096);
+
+static void *ptrs[4096];
+static int failures;
+
+PROCESS(memb_bench_process, "memb benchmark");
+AUTOSTART_PROCESSES(&memb_bench_process);
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(struct memb *m)
+{
+  int i, n, round, rounds;
+  double t;
+
+  n = m->num;
+  rounds = OPERATIONS / n;
+  memb_init(m);
+
+  t = now();
+  for(round = 0; round < rounds; round++) {
+    for(i = 0; i < n; i++) {
+      ptrs[i] = memb_alloc(m);
+    }
+    /* 7 is coprime with every pool size, so each block is freed once. */
+    for(i = 0; i < n; i++) {
+      if(memb_free(m, ptrs[(i * 7) % n]) != 0) {
+        failures++;
+      }
+    }
+  }
+  printf("%4d blocks: %6.1f ns per memb_alloc + memb_free\n",
+         n, (now() - t) / ((double)rounds * n) * 1e9);
+
+  if(memb_numfree(m) != n) {
+    printf("FAIL: %d of %d blocks free\n", memb_numfree(m), n);
+    failures++;
+  }
+
+#if MEMB_STATS
+  /* One double free, one misaligned pointer and one failed allocation
+     should all show up in the statistics. */
+  memb_free(m, ptrs[0]);
+  memb_free(m, (char *)ptrs[0] + 1);
+  for(i = 0; i <= n; i++) {
+    memb_alloc(m);
+  }
+  printf("             used %u max %u failed %u bad frees %u\n",
+         m->used, m->max_used, m->failed, m->bad_free);
+  if(m->used != n || m->failed != 1 || m->bad_free != 2) {
+    printf("FAIL: unexpected statistics\n");
+    failures++;
+  }
+#endif /* MEMB_STATS */
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(memb_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  bench(&pool8);
+  bench(&pool64);
+  bench(&pool512);
+  bench(&pool4096);
+
+  printf("%s\n", failures == 0 ? "OK" : "FAILED");
+  exit(failures == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
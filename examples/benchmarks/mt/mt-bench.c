@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Microbenchmark of the mt library on the native platform:
+ *         the cost of an mt_exec()/mt_yield() round trip, and the
+ *         stack usage reported by mtarch_stack_usage().
+ *
+ *         Build with DEFINES=MT_BENCH_OVERFLOW=1 to also run a thread
+ *         off the end of its stack, which should be stopped by the
+ *         stack guard.
+ */
+
+#include "contiki.h"
+#include "sys/mt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 1000000L
+
+static struct mt_thread yielder_thread, user_thread;
+
+PROCESS(mt_bench_process, "mt benchmark");
+AUTOSTART_PROCESSES(&mt_bench_process);
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+yielder(void *data)
+{
+  while(1) {
+    mt_yield();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+recurse(int depth)
+{
+  volatile char buf[256];
+
+  memset((char *)buf, depth, sizeof(buf));
+  return depth > 0 ? recurse(depth - 1) + buf[3] : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+user(void *data)
+{
+  recurse((int)(long)data);
+  mt_exit();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mt_bench_process, ev, data)
+{
+  static long i;
+  static double t;
+
+  PROCESS_BEGIN();
+
+  mt_init();
+
+  mt_start(&yielder_thread, yielder, NULL);
+  t = now();
+  for(i = 0; i < ROUNDS; i++) {
+    mt_exec(&yielder_thread);
+  }
+  printf("mt_exec + mt_yield: %.1f ns\n", (now() - t) / ROUNDS * 1e9);
+  printf("stack usage, yielding thread: %d bytes\n",
+         mtarch_stack_usage(&yielder_thread));
+  mt_stop(&yielder_thread);
+
+  mt_start(&user_thread, user, (void *)8);
+  mt_exec(&user_thread);
+  printf("stack usage, 8 frames of 256 bytes: %d bytes\n",
+         mtarch_stack_usage(&user_thread));
+  mt_stop(&user_thread);
+
+#if MT_BENCH_OVERFLOW
+  printf("running a thread past the end of its stack\n");
+  fflush(stdout);
+  mt_start(&user_thread, user, (void *)40);
+  mt_exec(&user_thread);
+  printf("FAILED: stack overflow not detected\n");
+  exit(1);
+#endif /* MT_BENCH_OVERFLOW */
+
+  mt_remove();
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Transmit throughput of the IPv6 network stack on the native
+ *         platform. UDP datagrams of several sizes are sent through
+ *         tcpip_output(), sicslowpan, the MAC and RDC layers and the
+ *         framer into a radio driver that only counts the frames and
+ *         hashes their contents. The hash makes it easy to check that
+ *         a change to the stack leaves the transmitted bytes unchanged.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "dev/radio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Number of datagrams sent for each size. */
+#define DATAGRAMS 200000L
+
+static const uint16_t sizes[] = { 80, 300, 600, 1200 };
+
+static unsigned long frames, bytes, hash;
+
+PROCESS(netstack_bench_process, "Netstack benchmark");
+AUTOSTART_PROCESSES(&netstack_bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+capture_send(const void *payload, unsigned short payload_len)
+{
+  const uint8_t *p = payload;
+  unsigned short i;
+
+  frames++;
+  bytes += payload_len;
+  for(i = 0; i < payload_len; i++) {
+    hash = hash * 33 + p[i];
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_init(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_prepare(const void *payload, unsigned short payload_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_zero(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver capture_radio_driver = {
+  capture_init,
+  capture_prepare,
+  capture_transmit,
+  capture_send,
+  capture_read,
+  capture_channel_clear,
+  capture_zero,
+  capture_zero,
+  capture_on,
+  capture_on,
+};
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_datagram(long seq, uint16_t len)
+{
+  struct uip_udpip_hdr *h = (struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN];
+  uint16_t i;
+
+  memset(h, 0, sizeof(*h));
+  h->vtc = 0x60;
+  h->proto = UIP_PROTO_UDP;
+  h->ttl = 64;
+  uip_ip6addr(&h->srcipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7401, 1, 0x0101);
+  uip_ip6addr(&h->destipaddr, 0xff02, 0, 0, 0, 0, 0, 0, 1);
+  h->srcport = UIP_HTONS(1000);
+  h->destport = UIP_HTONS(2000);
+  uip_len = len;
+  h->len[0] = (len - UIP_IPH_LEN) >> 8;
+  h->len[1] = (len - UIP_IPH_LEN) & 0xff;
+  h->udplen = UIP_HTONS(len - UIP_IPH_LEN);
+  for(i = UIP_IPUDPH_LEN; i < len; i++) {
+    uip_buf[UIP_LLH_LEN + i] = i + seq;
+  }
+  tcpip_output(NULL);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(netstack_bench_process, ev, data)
+{
+  long i;
+  unsigned s;
+  double t;
+
+  PROCESS_BEGIN();
+
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    frames = bytes = 0;
+    hash = 5381;
+    t = now();
+    for(i = 0; i < DATAGRAMS; i++) {
+      send_datagram(i, sizes[s]);
+    }
+    t = now() - t;
+    printf("%4u bytes: %8.0f datagrams/s %8.0f frames/s, %lu frames %lu bytes hash %08lx\n",
+           sizes[s], DATAGRAMS / t, frames / t, frames, bytes,
+           hash & 0xffffffffUL);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
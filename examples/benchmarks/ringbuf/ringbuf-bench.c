@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark and self-test of the ring buffer libraries on the
+ *         native platform: byte-wise ringbuf_put()/ringbuf_get()
+ *         against ringbuf_put_n()/ringbuf_get_n(), the span interface
+ *         of ringbufindex, and the multi-producer ringbufindex with
+ *         several host threads.
+ */
+
+#include "contiki.h"
+#include "lib/ringbuf.h"
+#include "lib/ringbufindex.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BYTES        10000000L
+#define FRAME_LEN    64
+#define PRODUCERS    4
+#define PER_PRODUCER 1000000L
+#define MPSC_SIZE    1024
+
+static struct ringbuf rb;
+static uint8_t rb_data[128];
+static uint8_t frame[FRAME_LEN];
+static uint8_t out[FRAME_LEN];
+
+static struct ringbufindex ri;
+static uint16_t ri_data[4096];
+
+static struct ringbufindex_mpsc mr;
+static unsigned long mr_data[MPSC_SIZE];
+
+static int failures;
+
+PROCESS(ringbuf_bench_process, "Ring buffer benchmark");
+AUTOSTART_PROCESSES(&ringbuf_bench_process);
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(int ok, const char *what)
+{
+  if(!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_bytes(void)
+{
+  long i;
+  int j, n;
+  unsigned long sum;
+  double t;
+
+  ringbuf_init(&rb, rb_data, sizeof(rb_data));
+  for(j = 0; j < FRAME_LEN; j++) {
+    frame[j] = j;
+  }
+
+  sum = 0;
+  t = now();
+  for(i = 0; i < BYTES / FRAME_LEN; i++) {
+    for(j = 0; j < FRAME_LEN; j++) {
+      ringbuf_put(&rb, frame[j]);
+    }
+    for(j = 0; j < FRAME_LEN; j++) {
+      sum += ringbuf_get(&rb);
+    }
+  }
+  printf("ringbuf_put/ringbuf_get:     %6.2f ns/byte\n",
+         (now() - t) / BYTES * 1e9);
+  check(sum == (BYTES / FRAME_LEN) * (FRAME_LEN * (FRAME_LEN - 1) / 2),
+        "byte-wise sum");
+
+  sum = 0;
+  t = now();
+  for(i = 0; i < BYTES / FRAME_LEN; i++) {
+    ringbuf_put_n(&rb, frame, FRAME_LEN);
+    n = ringbuf_get_n(&rb, out, FRAME_LEN);
+    sum += out[n - 1];
+  }
+  printf("ringbuf_put_n/ringbuf_get_n: %6.2f ns/byte\n",
+         (now() - t) / BYTES * 1e9);
+  check(sum == (BYTES / FRAME_LEN) * (FRAME_LEN - 1), "block sum");
+
+  /* Odd block sizes make the copies wrap around the end of the
+     buffer at every position. */
+  ringbuf_init(&rb, rb_data, sizeof(rb_data));
+  for(i = 0; i < 1000; i++) {
+    int w, r;
+    w = ringbuf_put_n(&rb, frame, (i * 7) % 50 + 1);
+    r = ringbuf_get_n(&rb, out, w);
+    check(r == w && memcmp(out, frame, r) == 0, "wrapped block copy");
+  }
+  check(ringbuf_elements(&rb) == 0, "empty after wrapped copies");
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_index(void)
+{
+  long i;
+  int j, n, m, idx;
+
+  ringbufindex_init(&ri, 4096);
+  for(i = 0; i < 100000; i++) {
+    n = ringbufindex_put_span(&ri, &idx);
+    m = n > 37 ? 37 : n;
+    for(j = 0; j < m; j++) {
+      ri_data[idx + j] = (uint16_t)(i + j);
+    }
+    ringbufindex_put_n(&ri, m);
+
+    n = ringbufindex_get_span(&ri, &idx);
+    for(j = 0; j < n; j++) {
+      check(ri_data[idx + j] == (uint16_t)(i + j), "span contents");
+    }
+    ringbufindex_get_n(&ri, n);
+  }
+
+  for(i = 0; i < 5000; i++) {
+    if(ringbufindex_put(&ri) == 0) {
+      break;
+    }
+  }
+  check(i == 4096 && ringbufindex_elements(&ri) == 4096 &&
+        ringbufindex_peek_put(&ri) == -1, "fill to capacity");
+}
+/*---------------------------------------------------------------------------*/
+static void *
+producer(void *arg)
+{
+  unsigned long id = (unsigned long)arg;
+  unsigned int pos;
+  long i;
+  int j, n;
+
+  /* Reservations of one to three elements make the producers
+     interleave at every position of the buffer. */
+  for(i = 0; i < PER_PRODUCER; i += n) {
+    n = 1 + i % 3;
+    if(n > PER_PRODUCER - i) {
+      n = PER_PRODUCER - i;
+    }
+    while(!ringbufindex_mpsc_reserve(&mr, n, &pos)) {
+      sched_yield();
+    }
+    for(j = 0; j < n; j++) {
+      mr_data[(pos + j) & (MPSC_SIZE - 1)] = (id << 24) | (i + j);
+    }
+    ringbufindex_mpsc_commit(&mr, pos, n);
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_mpsc(void)
+{
+  pthread_t threads[PRODUCERS];
+  long last[PRODUCERS];
+  long got;
+  int j, k, n, idx;
+  double t;
+
+  ringbufindex_mpsc_init(&mr, MPSC_SIZE);
+  for(j = 0; j < PRODUCERS; j++) {
+    last[j] = -1;
+  }
+
+  t = now();
+  for(j = 0; j < PRODUCERS; j++) {
+    pthread_create(&threads[j], NULL, producer, (void *)(unsigned long)j);
+  }
+  for(got = 0; got < PRODUCERS * PER_PRODUCER; got += n) {
+    n = ringbufindex_mpsc_get_span(&mr, &idx);
+    for(k = 0; k < n; k++) {
+      unsigned long v = mr_data[idx + k];
+      int p = v >> 24;
+      long seq = v & 0xffffff;
+      /* Elements of each producer must arrive in order, exactly once. */
+      check(p < PRODUCERS && seq == last[p] + 1, "mpsc ordering");
+      if(p < PRODUCERS) {
+        last[p] = seq;
+      }
+    }
+    ringbufindex_mpsc_get_n(&mr, n);
+    if(n == 0) {
+      sched_yield();
+    }
+  }
+  for(j = 0; j < PRODUCERS; j++) {
+    pthread_join(threads[j], NULL);
+  }
+  printf("ringbufindex_mpsc, %d producers: %6.2f ns/element\n",
+         PRODUCERS, (now() - t) / got * 1e9);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ringbuf_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  bench_bytes();
+  test_index();
+#if RINGBUFINDEX_MPSC
+  bench_mpsc();
+#endif /* RINGBUFINDEX_MPSC */
+
+  printf("%s\n", failures == 0 ? "OK" : "FAILED");
+  exit(failures == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
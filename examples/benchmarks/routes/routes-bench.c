@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Route table scaling benchmark for the native platform. Tables
+ *         of 10 to 10000 host routes, plus a few prefix routes, are
+ *         filled and looked up. Every lookup result is checked against
+ *         a linear longest-prefix match over the route list, before
+ *         and after routes are removed, re-added and updated. The time
+ *         per lookup is given for both uip_ds6_route_lookup() and the
+ *         linear scan.
+ *
+ *         Build with DEFINES=UIP_CONF_MAX_ROUTES=10004,UIP_CONF_DS6_ROUTE_HASH=<n>
+ *         to try another number of hash buckets, or 0 for none.
+ */
+
+#include "contiki.h"
+#include "net/uip-ds6.h"
+#include "lib/list.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Number of timed lookups for each table size. */
+#define LOOKUPS 2000000L
+/* Number of lookups checked against the linear scan. */
+#define CHECKS  20000
+
+static const unsigned sizes[] = { 10, 100, 1000, 10000 };
+
+static uip_ipaddr_t nexthop1, nexthop2;
+static unsigned failures;
+
+PROCESS(routes_bench_process, "Route table benchmark");
+AUTOSTART_PROCESSES(&routes_bench_process);
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/*---------------------------------------------------------------------------*/
+/* The longest-prefix match over the whole route list. */
+static uip_ds6_route_t *
+linear_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r, *found;
+  uint8_t longest;
+
+  found = NULL;
+  longest = 0;
+  for(r = uip_ds6_route_list_head(); r != NULL; r = list_item_next(r)) {
+    if(r->length >= longest &&
+       uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      longest = r->length;
+      found = r;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, unsigned i)
+{
+  uip_ip6addr(addr, 0xaaaa, 0, 0, 0, 0x0212,
+              0x7400 | (i >> 16), 0x0001 + (i & 0xffff), i * 7);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_lookups(unsigned n)
+{
+  uip_ipaddr_t addr;
+  unsigned i;
+
+  /* Half of the host addresses are not in the table. Some of the
+     destinations only match a prefix route, or no route at all. */
+  for(i = 0; i < CHECKS; i++) {
+    host_addr(&addr, rand() % (n * 2));
+    if(i % 5 == 0) {
+      addr.u8[0] = 0xbb;
+      addr.u8[1] = 0xbb;
+      addr.u8[3] = rand() & 1;
+    }
+    if(i % 7 == 0) {
+      addr.u8[0] = 0xcc;
+    }
+    if(uip_ds6_route_lookup(&addr) != linear_lookup(&addr)) {
+      failures++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_table(unsigned n)
+{
+  uip_ipaddr_t addr;
+  unsigned i;
+
+  uip_ds6_route_init();
+  for(i = 0; i < n; i++) {
+    host_addr(&addr, i);
+    uip_ds6_route_add(&addr, 128, (i & 1) ? &nexthop1 : &nexthop2, 0);
+  }
+  uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&addr, 64, &nexthop1, 0);
+  uip_ip6addr(&addr, 0xbbbb, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&addr, 16, &nexthop1, 0);
+  uip_ip6addr(&addr, 0xbbbb, 1, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&addr, 32, &nexthop2, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+change_table(unsigned n)
+{
+  uip_ipaddr_t addr;
+  unsigned i;
+
+  /* Remove half of the routes by next hop and some more one by one,
+     then add some back and update others. */
+  uip_ds6_route_rm_by_nexthop(&nexthop2);
+  for(i = 1; i < n; i += 6) {
+    host_addr(&addr, i);
+    uip_ds6_route_rm(uip_ds6_route_lookup(&addr));
+  }
+  for(i = 0; i < n; i += 4) {
+    host_addr(&addr, i);
+    uip_ds6_route_add(&addr, 128, &nexthop1, 3);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(unsigned n)
+{
+  uip_ipaddr_t addr;
+  long i, lookups, hits;
+  double t, linear;
+
+  fill_table(n);
+  check_lookups(n);
+
+  hits = 0;
+  t = now();
+  for(i = 0; i < LOOKUPS; i++) {
+    host_addr(&addr, (i * 2654435761u) % n);
+    hits += uip_ds6_route_lookup(&addr) != NULL;
+  }
+  t = now() - t;
+
+  /* The linear scan is too slow to run as many lookups on the
+     large tables. */
+  lookups = LOOKUPS / n;
+  linear = now();
+  for(i = 0; i < lookups; i++) {
+    host_addr(&addr, (i * 2654435761u) % n);
+    hits += linear_lookup(&addr) != NULL;
+  }
+  linear = now() - linear;
+
+  if(hits != LOOKUPS + lookups) {
+    failures++;
+  }
+
+  change_table(n);
+  check_lookups(n);
+
+  printf("%5u routes: %7.1f ns/lookup, linear scan %8.1f ns/lookup, %d left\n",
+         n, t / LOOKUPS * 1e9, linear / lookups * 1e9,
+         uip_ds6_route_num_routes());
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(routes_bench_process, ev, data)
+{
+  unsigned s;
+
+  PROCESS_BEGIN();
+
+  srand(1);
+  uip_ip6addr(&nexthop1, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_ip6addr(&nexthop2, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+
+  printf("UIP_DS6_ROUTE_HASH %d\n", UIP_DS6_ROUTE_HASH);
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    if(sizes[s] + 3 > UIP_DS6_ROUTE_NB) {
+      break;
+    }
+    bench(sizes[s]);
+  }
+
+  printf("%s\n", failures == 0 ? "OK" : "FAILED");
+  exit(failures == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -282,9 +282,11 @@ serial_input(FILE *inslip)
 
 unsigned char slip_buf[2048];
 int slip_end, slip_begin, slip_packet_end, slip_packet_count;
-static struct timer send_delay_timer;
+static struct ctimer send_delay_timer;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
+
+static struct native_fd slip_nfd;
 /*---------------------------------------------------------------------------*/
 static void
 slip_send(int fd, unsigned char c)
@@ -310,6 +312,26 @@ slip_empty()
   return slip_packet_end == 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Always read from slip, and wait for writing only when there is a
+   packet to flush and the delay since the previous packet is over. */
+static void
+update_events(void)
+{
+  int events;
+
+  events = NATIVE_FD_READ;
+  if(!slip_empty() && (send_delay == 0 || ctimer_expired(&send_delay_timer))) {
+    events |= NATIVE_FD_WRITE;
+  }
+  native_fd_set_events(&slip_nfd, events);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_delay_done(void *ptr)
+{
+  update_events();
+}
+/*---------------------------------------------------------------------------*/
 void
 slip_flushbuf(int fd)
 {
@@ -345,7 +367,7 @@ slip_flushbuf(int fd)
         }
         /* a delay between slip packets to avoid losing data */
         if(send_delay > 0) {
-          timer_set(&send_delay_timer, send_delay);
+          ctimer_set(&send_delay_timer, send_delay, send_delay_done, NULL);
         }
       }
     }
@@ -401,6 +423,7 @@ write_to_serial(int outfd, const uint8_t *inbuf, int len)
     }
   }
   slip_send(outfd, SLIP_END);
+  update_events();
   PROGRESS("t");
 }
 /*---------------------------------------------------------------------------*/
@@ -459,32 +482,19 @@ stty_telos(int fd)
   if(tcflush(fd, TCIOFLUSH) == -1) err(1, "tcflush");
 }
 /*---------------------------------------------------------------------------*/
-static int
-set_fd(fd_set *rset, fd_set *wset)
-{
-  /* Anything to flush? */
-  if(!slip_empty() && (send_delay == 0 || timer_expired(&send_delay_timer))) {
-    FD_SET(slipfd, wset);
-  }
-
-  FD_SET(slipfd, rset);	/* Read from slip ASAP! */
-  return 1;
-}
-/*---------------------------------------------------------------------------*/
 static void
-handle_fd(fd_set *rset, fd_set *wset)
+slip_handler(struct native_fd *nfd, int events)
 {
-  if(FD_ISSET(slipfd, rset)) {
+  if(events & NATIVE_FD_READ) {
     serial_input(inslip);
   }
 
-  if(FD_ISSET(slipfd, wset)) {
+  if(events & NATIVE_FD_WRITE) {
     slip_flushbuf(slipfd);
+    update_events();
   }
 }
 /*---------------------------------------------------------------------------*/
-static const struct select_callback slip_callback = { set_fd, handle_fd };
-/*---------------------------------------------------------------------------*/
 void
 slip_init(void)
 {
@@ -526,7 +536,7 @@ slip_init(void)
     }
   }
 
-  select_set_callback(slipfd, &slip_callback);
+  native_fd_add(&slip_nfd, slipfd, NATIVE_FD_READ, slip_handler, NULL);
 
   if(slip_config_host != NULL) {
     fprintf(stderr, "********SLIP opened to ``%s:%s''\n", slip_config_host,
@@ -536,8 +546,8 @@ slip_init(void)
     stty_telos(slipfd);
   }
 
-  timer_set(&send_delay_timer, 0);
   slip_send(slipfd, SLIP_END);
+  update_events();
   inslip = fdopen(slipfd, "r");
   if(inslip == NULL) {
     err(1, "main: fdopen");
@@ -72,12 +72,8 @@ extern uint16_t slip_config_basedelay;
 #ifndef __CYGWIN__
 static int tunfd;
 
-static int set_fd(fd_set *rset, fd_set *wset);
-static void handle_fd(fd_set *rset, fd_set *wset);
-static const struct select_callback tun_select_callback = {
-  set_fd,
-  handle_fd
-};
+static struct native_fd tun_nfd;
+static void tun_handler(struct native_fd *nfd, int events);
 #endif /* __CYGWIN__ */
 
 int ssystem(const char *fmt, ...)
@@ -195,8 +191,7 @@ tun_init()
 
 #else
 
-static uint16_t delaymsec=0;
-static uint32_t delaystartsec,delaystartmsec;
+static struct ctimer delay_timer;
 
 /*---------------------------------------------------------------------------*/
 void
@@ -209,7 +204,7 @@ tun_init()
   tunfd = tun_alloc(slip_config_tundev);
   if(tunfd == -1) err(1, "main: open");
 
-  select_set_callback(tunfd, &tun_select_callback);
+  native_fd_add(&tun_nfd, tunfd, NATIVE_FD_READ, tun_handler, NULL);
 
   fprintf(stderr, "opened %s device ``/dev/%s''\n",
           "tun", slip_config_tundev);
@@ -261,48 +256,31 @@ const struct uip_fallback_interface rpl_interface = {
 };
 
 /*---------------------------------------------------------------------------*/
-/* tun and slip select callback                                              */
+/* tun file descriptor handler                                               */
 /*---------------------------------------------------------------------------*/
-static int
-set_fd(fd_set *rset, fd_set *wset)
+static void
+delay_done(void *ptr)
 {
-  FD_SET(tunfd, rset);
-  return 1;
+  native_fd_set_events(&tun_nfd, NATIVE_FD_READ);
 }
-
 /*---------------------------------------------------------------------------*/
-
 static void
-handle_fd(fd_set *rset, fd_set *wset)
+tun_handler(struct native_fd *nfd, int events)
 {
-  /* Optional delay between outgoing packets */
-  /* Base delay times number of 6lowpan fragments to be sent */
-  /* delaymsec = 10; */
-  if(delaymsec) {
-    struct timeval tv;
-    int dmsec;
-    gettimeofday(&tv, NULL);
-    dmsec=(tv.tv_sec-delaystartsec)*1000+tv.tv_usec/1000-delaystartmsec;
-    if(dmsec<0) delaymsec=0;
-    if(dmsec>delaymsec) delaymsec=0;
-  }
+  int size;
 
-  if(delaymsec==0) {
-    int size;
-
-    if(FD_ISSET(tunfd, rset)) {
-      size = tun_input(&uip_buf[UIP_LLH_LEN], sizeof(uip_buf));
-      /* printf("TUN data incoming read:%d\n", size); */
-      uip_len = size;
-      tcpip_input();
-
-      if(slip_config_basedelay) {
-        struct timeval tv;
-      	gettimeofday(&tv, NULL) ;
-      	delaymsec=slip_config_basedelay;
-      	delaystartsec =tv.tv_sec;
-      	delaystartmsec=tv.tv_usec/1000;
-      }
+  if(events & NATIVE_FD_READ) {
+    size = tun_input(&uip_buf[UIP_LLH_LEN], sizeof(uip_buf));
+    /* printf("TUN data incoming read:%d\n", size); */
+    uip_len = size;
+    tcpip_input();
+
+    /* Optional delay between outgoing packets. The tun device is not
+       read until the delay is over. */
+    if(slip_config_basedelay) {
+      native_fd_set_events(nfd, 0);
+      ctimer_set(&delay_timer, slip_config_basedelay * CLOCK_SECOND / 1000,
+                 delay_done, NULL);
     }
   }
 }
@@ -38,6 +38,55 @@
 #include <sys/select.h>
 #endif
 
+/*
+ * File descriptors that the main loop waits for. The main loop uses
+ * epoll on Linux and select() elsewhere, and sleeps until either a
+ * registered file descriptor is ready, the next event timer expires,
+ * or a process is polled.
+ *
+ * The native_fd structure is owned by the caller and must stay valid
+ * while it is registered. There is no limit on the number of
+ * registered file descriptors.
+ *
+ * A hang-up or an error on a file descriptor is reported to the
+ * handler as NATIVE_FD_ERROR, together with NATIVE_FD_READ if the
+ * handler waits for reading. If the handler does not wait for reading
+ * and does not remove the file descriptor after an error, the main
+ * loop removes it, since it would otherwise be reported as ready again
+ * at once.
+ */
+#define NATIVE_FD_READ  1
+#define NATIVE_FD_WRITE 2
+#define NATIVE_FD_ERROR 4
+
+struct native_fd {
+  struct native_fd *next;
+  void (* handler)(struct native_fd *nfd, int events);
+  void *ptr;
+  int fd;
+  int events;
+  int pollable;
+};
+
+int native_fd_add(struct native_fd *nfd, int fd, int events,
+                  void (* handler)(struct native_fd *nfd, int events),
+                  void *ptr);
+int native_fd_set_events(struct native_fd *nfd, int events);
+void native_fd_remove(struct native_fd *nfd);
+void native_wakeup(void);
+
+#ifdef __linux__
+/* Wake up the main loop when a process is polled from a signal
+   handler or another thread. */
+#define PROCESS_CONF_POLL_HOOK() native_wakeup()
+#endif /* __linux__ */
+
+/*
+ * The older select_set_callback() interface is still supported for
+ * up to SELECT_CONF_MAX callbacks. Since these callbacks decide what
+ * to wait for each time around the loop, the main loop does not sleep
+ * for more than a millisecond while any of them are registered.
+ */
 struct select_callback {
   int  (* set_fd)(fd_set *fdr, fd_set *fdw);
   void (* handle_fd)(fd_set *fdr, fd_set *fdw);
@@ -75,10 +124,28 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_LOGGING         0
 #define UIP_CONF_UDP_CHECKSUMS   1
 
+/* Use the word-at-a-time checksum functions in cpu/native/uip_arch.c */
+#ifndef UIP_ARCH_CHKSUM
+#define UIP_ARCH_CHKSUM          1
+#endif /* UIP_ARCH_CHKSUM */
+
 #ifndef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 8
 #endif /* NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE */
 
+/* Native gateways forward many flows through CSMA, so do not let one
+   neighbor take all packet buffers, keep buffers for control packets,
+   and let the neighbor queues take turns. */
+#ifndef CSMA_CONF_MAX_PACKETS_PER_NEIGHBOR
+#define CSMA_CONF_MAX_PACKETS_PER_NEIGHBOR 4
+#endif /* CSMA_CONF_MAX_PACKETS_PER_NEIGHBOR */
+#ifndef CSMA_CONF_CONTROL_RESERVE
+#define CSMA_CONF_CONTROL_RESERVE 2
+#endif /* CSMA_CONF_CONTROL_RESERVE */
+#ifndef CSMA_CONF_DRR_QUANTUM
+#define CSMA_CONF_DRR_QUANTUM 128
+#endif /* CSMA_CONF_DRR_QUANTUM */
+
 #if UIP_CONF_IPV6
 
 #define RIMEADDR_CONF_SIZE              8
@@ -119,6 +186,9 @@ typedef unsigned short uip_stats_t;
 #ifndef SICSLOWPAN_CONF_MAX_MAC_TRANSMISSIONS
 #define SICSLOWPAN_CONF_MAX_MAC_TRANSMISSIONS   5
 #endif /* SICSLOWPAN_CONF_MAX_MAC_TRANSMISSIONS */
+#ifndef SICSLOWPAN_CONF_PRIORITIZE_CONTROL
+#define SICSLOWPAN_CONF_PRIORITIZE_CONTROL      1
+#endif /* SICSLOWPAN_CONF_PRIORITIZE_CONTROL */
 
 #define UIP_CONF_IPV6_CHECKS     1
 #define UIP_CONF_IPV6_QUEUE_PKT  1
@@ -133,9 +203,15 @@ typedef unsigned short uip_stats_t;
 #ifndef UIP_CONF_DS6_NBR_NBU
 #define UIP_CONF_DS6_NBR_NBU     30
 #endif /* UIP_CONF_DS6_NBR_NBU */
+#ifndef UIP_CONF_DS6_NBR_HASH
+#define UIP_CONF_DS6_NBR_HASH    64
+#endif /* UIP_CONF_DS6_NBR_HASH */
 #ifndef UIP_CONF_MAX_ROUTES
 #define UIP_CONF_MAX_ROUTES   30
 #endif /* UIP_CONF_MAX_ROUTES */
+#ifndef UIP_CONF_DS6_ROUTE_HASH
+#define UIP_CONF_DS6_ROUTE_HASH  64
+#endif /* UIP_CONF_DS6_ROUTE_HASH */
 
 #define UIP_CONF_ND6_SEND_RA		0
 #define UIP_CONF_ND6_REACHABLE_TIME     600000
@@ -244,6 +320,54 @@ typedef unsigned long clock_time_t;
 
 #define CLOCK_CONF_SECOND 1000
 
+/* Real-time timers use a 32-bit clock, which allows the microsecond
+   resolution timerfd backend to be used on Linux. */
+typedef uint32_t rtimer_clock_t;
+#define RTIMER_CLOCK_LT(a,b)     ((int32_t)((a)-(b)) < 0)
+
+#if defined(__linux__) && !defined(RTIMER_ARCH_CONF_TIMERFD)
+#define RTIMER_ARCH_CONF_TIMERFD 1
+#endif /* __linux__ && !RTIMER_ARCH_CONF_TIMERFD */
+
+/* Native gateways run many concurrent timers, so keep the pending
+   event timers in a heap instead of a list. */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 1
+#endif /* ETIMER_CONF_HEAP */
+
+/* Native pools can be large, so find free blocks in constant time
+   and keep statistics for sizing the pools. */
+#ifndef MEMB_CONF_FREELIST
+#define MEMB_CONF_FREELIST 1
+#endif /* MEMB_CONF_FREELIST */
+#ifndef MEMB_CONF_STATS
+#define MEMB_CONF_STATS 1
+#endif /* MEMB_CONF_STATS */
+
+/* Keep managed memory in place instead of compacting it. */
+#ifndef MMEM_CONF_SIZE_CLASSES
+#define MMEM_CONF_SIZE_CLASSES 1
+#endif /* MMEM_CONF_SIZE_CLASSES */
+
+/* Let bursts of events spill over into a pool instead of being
+   dropped, and keep track of how full the event queue gets. */
+#ifndef PROCESS_CONF_EVENT_OVERFLOW
+#define PROCESS_CONF_EVENT_OVERFLOW 32
+#endif /* PROCESS_CONF_EVENT_OVERFLOW */
+#ifndef PROCESS_CONF_EVENT_STATS
+#define PROCESS_CONF_EVENT_STATS 1
+#endif /* PROCESS_CONF_EVENT_STATS */
+#ifndef PROCESS_CONF_TIMING
+#define PROCESS_CONF_TIMING 1
+#endif /* PROCESS_CONF_TIMING */
+
+/* Threads on the host may hand data to Contiki through ring buffers
+   with several producers. */
+#ifndef RINGBUFINDEX_CONF_MPSC
+#define RINGBUFINDEX_CONF_MPSC 1
+#define RINGBUFINDEX_CONF_MPSC_WAIT() sched_yield()
+#endif /* RINGBUFINDEX_CONF_MPSC */
+
 #define LOG_CONF_ENABLED 1
 
 #define PROGRAM_HANDLER_CONF_MAX_NUMDSCS 10
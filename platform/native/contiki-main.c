@@ -31,10 +31,21 @@
  *
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define NATIVE_EPOLL 1
+#else /* __linux__ */
+#define NATIVE_EPOLL 0
+#endif /* __linux__ */
 
 #ifdef __CYGWIN__
 #include "net/wpcap-drv.h"
@@ -66,65 +77,416 @@
 #define SELECT_MAX 8
 #endif
 
+/* The maximum number of ready file descriptors handled per epoll_wait(). */
+#define MAX_READY 32
+
+/* All registered file descriptors. */
+static struct native_fd *fd_list;
+/* Number of registered file descriptors that cannot be waited for,
+   such as regular files, and therefore are always considered ready. */
+static int fd_always_ready;
+
+#if NATIVE_EPOLL
+static int epoll_fd = -1;
+static int wakeup_fd = -1;
+static struct native_fd wakeup_nfd;
+#endif /* NATIVE_EPOLL */
+static volatile int sleeping;
+
+/* Storage for the callbacks registered with select_set_callback(). */
+static struct native_fd select_nfd[SELECT_MAX];
 static const struct select_callback *select_callback[SELECT_MAX];
-static int select_max = 0;
+static int select_count;
 
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
 static uint16_t node_id = 0x0102;
 /*---------------------------------------------------------------------------*/
+#if NATIVE_EPOLL
+static uint32_t
+epoll_events(int events)
+{
+  return ((events & NATIVE_FD_READ) ? EPOLLIN : 0) |
+    ((events & NATIVE_FD_WRITE) ? EPOLLOUT : 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+wakeup_handler(struct native_fd *nfd, int events)
+{
+  uint64_t count;
+
+  if(read(nfd->fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    perror("wakeup read");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_epoll(void)
+{
+  if(epoll_fd >= 0) {
+    return;
+  }
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll_fd < 0) {
+    perror("epoll_create1");
+    exit(1);
+  }
+  wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(wakeup_fd < 0) {
+    perror("eventfd");
+    exit(1);
+  }
+  native_fd_add(&wakeup_nfd, wakeup_fd, NATIVE_FD_READ, wakeup_handler, NULL);
+}
+#endif /* NATIVE_EPOLL */
+/*---------------------------------------------------------------------------*/
 int
-select_set_callback(int fd, const struct select_callback *callback)
+native_fd_add(struct native_fd *nfd, int fd, int events,
+              void (* handler)(struct native_fd *nfd, int events),
+              void *ptr)
 {
-  int i;
-  if(fd >= 0 && fd < SELECT_MAX) {
-    /* Check that the callback functions are set */
-    if(callback != NULL &&
-       (callback->set_fd == NULL || callback->handle_fd == NULL)) {
-      callback = NULL;
-    }
+  nfd->fd = fd;
+  nfd->events = events;
+  nfd->handler = handler;
+  nfd->ptr = ptr;
+  nfd->pollable = 1;
 
-    select_callback[fd] = callback;
+#if NATIVE_EPOLL
+  {
+    struct epoll_event ev;
+
+    init_epoll();
+    ev.events = epoll_events(events);
+    ev.data.ptr = nfd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      if(errno != EPERM) {
+        perror("epoll_ctl");
+        return 0;
+      }
+      /* Regular files cannot be waited for, but are always ready. */
+      nfd->pollable = 0;
+      fd_always_ready++;
+    }
+  }
+#else /* NATIVE_EPOLL */
+  if(fd < 0 || fd >= FD_SETSIZE) {
+    return 0;
+  }
+#endif /* NATIVE_EPOLL */
 
-    /* Update fd max */
-    if(callback != NULL) {
-      if(fd > select_max) {
-        select_max = fd;
+  nfd->next = fd_list;
+  fd_list = nfd;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+native_fd_set_events(struct native_fd *nfd, int events)
+{
+  if(nfd->events == events) {
+    return 1;
+  }
+  nfd->events = events;
+#if NATIVE_EPOLL
+  if(nfd->pollable) {
+    struct epoll_event ev;
+
+    ev.events = epoll_events(events);
+    ev.data.ptr = nfd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, nfd->fd, &ev) < 0) {
+      perror("epoll_ctl");
+      return 0;
+    }
+  }
+#endif /* NATIVE_EPOLL */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+native_fd_remove(struct native_fd *nfd)
+{
+  struct native_fd **n;
+
+  for(n = &fd_list; *n != NULL; n = &(*n)->next) {
+    if(*n == nfd) {
+      *n = nfd->next;
+#if NATIVE_EPOLL
+      if(nfd->pollable) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, nfd->fd, NULL);
+      }
+#endif /* NATIVE_EPOLL */
+      if(!nfd->pollable) {
+        fd_always_ready--;
       }
-    } else {
-      select_max = 0;
-      for(i = SELECT_MAX - 1; i > 0; i--) {
-        if(select_callback[i] != NULL) {
-          select_max = i;
-          break;
+      /* Make sure that any pending readiness is not reported. */
+      nfd->fd = -1;
+      nfd->next = NULL;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+native_wakeup(void)
+{
+#if NATIVE_EPOLL
+  uint64_t one = 1;
+
+  if(sleeping && wakeup_fd >= 0) {
+    if(write(wakeup_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      perror("wakeup write");
+    }
+  }
+#endif /* NATIVE_EPOLL */
+}
+/*---------------------------------------------------------------------------*/
+static void
+select_handler(struct native_fd *nfd, int events)
+{
+  const struct select_callback *callback = nfd->ptr;
+  fd_set fdr;
+  fd_set fdw;
+
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  if(events & NATIVE_FD_READ) {
+    FD_SET(nfd->fd, &fdr);
+  }
+  if(events & NATIVE_FD_WRITE) {
+    FD_SET(nfd->fd, &fdw);
+  }
+  callback->handle_fd(&fdr, &fdw);
+}
+/*---------------------------------------------------------------------------*/
+/* Ask the select_set_callback() callbacks what they want to wait for. */
+static void
+select_update(void)
+{
+  fd_set fdr;
+  fd_set fdw;
+  int i;
+  int events;
+
+  for(i = 0; i < SELECT_MAX; i++) {
+    if(select_callback[i] != NULL) {
+      FD_ZERO(&fdr);
+      FD_ZERO(&fdw);
+      events = 0;
+      if(select_callback[i]->set_fd(&fdr, &fdw)) {
+        if(FD_ISSET(select_nfd[i].fd, &fdr)) {
+          events |= NATIVE_FD_READ;
+        }
+        if(FD_ISSET(select_nfd[i].fd, &fdw)) {
+          events |= NATIVE_FD_WRITE;
         }
       }
+      native_fd_set_events(&select_nfd[i], events);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+select_set_callback(int fd, const struct select_callback *callback)
+{
+  int i;
+
+  if(fd < 0 || fd >= FD_SETSIZE) {
+    return 0;
+  }
+
+  /* Check that the callback functions are set */
+  if(callback != NULL &&
+     (callback->set_fd == NULL || callback->handle_fd == NULL)) {
+    callback = NULL;
+  }
+
+  /* Remove any callback that is already registered for fd. */
+  for(i = 0; i < SELECT_MAX; i++) {
+    if(select_callback[i] != NULL && select_nfd[i].fd == fd) {
+      native_fd_remove(&select_nfd[i]);
+      select_callback[i] = NULL;
+      select_count--;
     }
+  }
+
+  if(callback == NULL) {
     return 1;
   }
+
+  for(i = 0; i < SELECT_MAX; i++) {
+    if(select_callback[i] == NULL) {
+      if(!native_fd_add(&select_nfd[i], fd, 0, select_handler,
+                        (void *)callback)) {
+        return 0;
+      }
+      select_callback[i] = callback;
+      select_count++;
+      return 1;
+    }
+  }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Return the number of milliseconds that the main loop may sleep,
+   or -1 to sleep until a file descriptor becomes ready. */
 static int
-stdin_set_fd(fd_set *rset, fd_set *wset)
+sleep_time(void)
 {
-  FD_SET(STDIN_FILENO, rset);
-  return 1;
+  clock_time_t left;
+  int timeout;
+
+  if(process_nevents() > 0 || fd_always_ready > 0) {
+    return 0;
+  }
+
+  timeout = -1;
+  if(etimer_pending()) {
+    left = etimer_next_expiration_time() - clock_time();
+    if((long)left <= 0) {
+      return 0;
+    }
+    timeout = left > INT_MAX ? INT_MAX : (int)left;
+  }
+
+#if WITH_GUI
+  /* The curses console is polled for input. */
+  if(timeout < 0 || timeout > 1) {
+    timeout = 1;
+  }
+#endif /* WITH_GUI */
+  if(select_count > 0 && (timeout < 0 || timeout > 1)) {
+    timeout = 1;
+  }
+  return timeout;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_for_events(void)
+{
+  struct native_fd *nfd, *next;
+  int timeout;
+#if NATIVE_EPOLL
+  struct epoll_event ready[MAX_READY];
+  int events;
+  int i;
+  int n;
+#else /* NATIVE_EPOLL */
+  fd_set fdr;
+  fd_set fdw;
+  struct timeval tv;
+  int maxfd;
+  int n;
+#endif /* NATIVE_EPOLL */
+
+  select_update();
+
+  /* A process may be polled from a signal handler or another thread
+     after we have decided how long to sleep, so the sleeping flag is
+     set first and the events are checked again. */
+  sleeping = 1;
+  timeout = sleep_time();
+
+#if NATIVE_EPOLL
+  init_epoll();
+  n = epoll_wait(epoll_fd, ready, MAX_READY, timeout);
+  sleeping = 0;
+  if(n < 0) {
+    if(errno != EINTR) {
+      perror("epoll_wait");
+    }
+    n = 0;
+  }
+  for(i = 0; i < n; i++) {
+    nfd = ready[i].data.ptr;
+    if(nfd->fd < 0) {
+      /* Removed by an earlier handler. */
+      continue;
+    }
+    events = 0;
+    if(ready[i].events & EPOLLIN) {
+      events |= NATIVE_FD_READ;
+    }
+    if(ready[i].events & EPOLLOUT) {
+      events |= NATIVE_FD_WRITE;
+    }
+    if(ready[i].events & (EPOLLHUP | EPOLLERR)) {
+      /* A reader sees the end of file or the error when it reads. */
+      events |= NATIVE_FD_ERROR | NATIVE_FD_READ;
+    }
+    events &= nfd->events | NATIVE_FD_ERROR;
+    nfd->handler(nfd, events);
+    if((events & NATIVE_FD_ERROR) && nfd->fd >= 0 &&
+       !(nfd->events & NATIVE_FD_READ)) {
+      native_fd_remove(nfd);
+    }
+  }
+#else /* NATIVE_EPOLL */
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  maxfd = -1;
+  for(nfd = fd_list; nfd != NULL; nfd = nfd->next) {
+    if(nfd->events & NATIVE_FD_READ) {
+      FD_SET(nfd->fd, &fdr);
+    }
+    if(nfd->events & NATIVE_FD_WRITE) {
+      FD_SET(nfd->fd, &fdw);
+    }
+    if(nfd->events && nfd->fd > maxfd) {
+      maxfd = nfd->fd;
+    }
+  }
+  if(timeout >= 0) {
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+  }
+  n = select(maxfd + 1, &fdr, &fdw, NULL, timeout >= 0 ? &tv : NULL);
+  sleeping = 0;
+  if(n < 0) {
+    if(errno != EINTR) {
+      perror("select");
+    }
+  } else if(n > 0) {
+    for(nfd = fd_list; nfd != NULL; nfd = next) {
+      next = nfd->next;
+      if(FD_ISSET(nfd->fd, &fdr) || FD_ISSET(nfd->fd, &fdw)) {
+        nfd->handler(nfd, (FD_ISSET(nfd->fd, &fdr) ? NATIVE_FD_READ : 0) |
+                     (FD_ISSET(nfd->fd, &fdw) ? NATIVE_FD_WRITE : 0));
+      }
+    }
+  }
+#endif /* NATIVE_EPOLL */
+
+  /* File descriptors that cannot be waited for are always ready. */
+  if(fd_always_ready > 0) {
+    for(nfd = fd_list; nfd != NULL; nfd = next) {
+      next = nfd->next;
+      if(!nfd->pollable && nfd->events != 0) {
+        nfd->handler(nfd, nfd->events);
+      }
+    }
+  }
 }
+/*---------------------------------------------------------------------------*/
 static void
-stdin_handle_fd(fd_set *rset, fd_set *wset)
+stdin_handler(struct native_fd *nfd, int events)
 {
-  char c;
-  if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
-      serial_line_input_byte(c);
+  char buf[64];
+  int i;
+  int n;
+
+  if(events & NATIVE_FD_READ) {
+    n = read(STDIN_FILENO, buf, sizeof(buf));
+    if(n > 0) {
+      for(i = 0; i < n; i++) {
+        serial_line_input_byte(buf[i]);
+      }
+    } else if(n == 0 || errno != EAGAIN) {
+      /* End of input. */
+      native_fd_remove(nfd);
     }
   }
 }
-const static struct select_callback stdin_fd = {
-  stdin_set_fd, stdin_handle_fd
-};
+static struct native_fd stdin_nfd;
 /*---------------------------------------------------------------------------*/
 static void
 set_rime_addr(void)
@@ -190,6 +552,7 @@ main(int argc, char **argv)
   process_init();
   process_start(&etimer_process, NULL);
   ctimer_init();
+  rtimer_init();
 
 #if WITH_GUI
   process_start(&ctk_process, NULL);
@@ -234,42 +597,18 @@ main(int argc, char **argv)
   /* Make standard output unbuffered. */
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
-  select_set_callback(STDIN_FILENO, &stdin_fd);
+  native_fd_add(&stdin_nfd, STDIN_FILENO, NATIVE_FD_READ, stdin_handler, NULL);
   while(1) {
-    fd_set fdr;
-    fd_set fdw;
-    int maxfd;
-    int i;
-    int retval;
-    struct timeval tv;
-
-    retval = process_run();
-
-    tv.tv_sec = 0;
-    tv.tv_usec = retval ? 1 : 1000;
-
-    FD_ZERO(&fdr);
-    FD_ZERO(&fdw);
-    maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
-      }
+    /* Only poll the etimer process when a timer actually has
+       expired. */
+    if(etimer_pending() &&
+       (long)(clock_time() - etimer_next_expiration_time()) >= 0) {
+      etimer_request_poll();
     }
 
-    retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
-    if(retval < 0) {
-      perror("select");
-    } else if(retval > 0) {
-      /* timeout => retval == 0 */
-      for(i = 0; i <= maxfd; i++) {
-        if(select_callback[i] != NULL) {
-          select_callback[i]->handle_fd(&fdr, &fdw);
-        }
-      }
-    }
+    process_run();
 
-    etimer_request_poll();
+    wait_for_events();
 
 #if WITH_GUI
     if(console_resize()) {